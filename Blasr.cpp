@@ -23,6 +23,8 @@ PacBio::BAM::IRecordWriter *bamWriterPtr = NULL;  // use IRecordWriter for both
 
 HDFRegionTableReader *regionTableReader = NULL;
 ReaderAgglomerate *reader = NULL;
+ReadPrefetcher *readPrefetcher = NULL;
+RegionTableStream *regionTableStream = NULL;
 
 // Add comment to version history for each version change !
 //
@@ -172,7 +174,8 @@ void MakePrimaryIntervals(std::vector<SMRTSequence> &subreads,
 /// \params[in] reader: FASTA/FASTQ/BAX.H5/CCS.H5/BAM file reader
 /// \params[in] regionTablePtr: RGN.H5 region table pointer.
 /// \params[in] params: mapping parameters.
-/// \params[out] smrtRead: to save smrt sequence.
+/// \params[out] smrtReads: to save smrt sequence, as smrtReads[0].  Reads decoded
+///              by the prefetch thread are swapped in rather than copied.
 /// \params[out] ccsRead: to save ccs sequence.
 /// \params[out] readIsCCS: read is CCSSequence.
 /// \params[out] readGroupId: associated read group id
@@ -180,38 +183,53 @@ void MakePrimaryIntervals(std::vector<SMRTSequence> &subreads,
 ///              required to for generating deterministic random
 ///              alignments regardless of nproc.
 /// \params[out] stop: whether or not stop mapping remaining reads.
+/// \params[in] telemetry: where to record time waiting for reads, may be NULL.
 /// \returns whether or not to skip mapping reads of this zmw.
-bool FetchReads(ReaderAgglomerate *reader, RegionTable *regionTablePtr, SMRTSequence &smrtRead,
-                CCSSequence &ccsRead, std::vector<SMRTSequence> &subreads,
-                MappingParameters &params, bool &readIsCCS, std::string &readGroupId,
-                int &associatedRandInt, bool &stop)
+bool FetchReads(ReaderAgglomerate *reader, RegionTable *regionTablePtr,
+                std::vector<SMRTSequence> &smrtReads, CCSSequence &ccsRead,
+                std::vector<SMRTSequence> &subreads, MappingParameters &params, bool &readIsCCS,
+                std::string &readGroupId, int &associatedRandInt, bool &stop,
+                ThreadTelemetry *telemetry)
 {
+    TelemetryTimer waitTimer(telemetry);
     if ((reader->GetFileType() != FileType::PBBAM and
          reader->GetFileType() != FileType::PBDATASET) or
         not params.concordant) {
         if (reader->GetFileType() == FileType::HDFCCS ||
             reader->GetFileType() == FileType::HDFCCSONLY) {
             if (GetNextReadThroughSemaphore(*reader, params, ccsRead, readGroupId,
-                                            associatedRandInt, semaphores) == false) {
+                                            associatedRandInt, semaphores, regionTableStream,
+                                            regionTablePtr, telemetry) == false) {
                 stop = true;
                 return false;
             } else {
                 readIsCCS = true;
-                smrtRead.Copy(ccsRead);
+                smrtReads[0].Copy(ccsRead);
                 ccsRead.SetQVScale(params.qvScaleType);
-                smrtRead.SetQVScale(params.qvScaleType);
+                smrtReads[0].SetQVScale(params.qvScaleType);
             }
-            assert(ccsRead.zmwData.holeNumber == smrtRead.zmwData.holeNumber and
+            assert(ccsRead.zmwData.holeNumber == smrtReads[0].zmwData.holeNumber and
                    ccsRead.zmwData.holeNumber == ccsRead.unrolledRead.zmwData.holeNumber);
         } else {
-            if (GetNextReadThroughSemaphore(*reader, params, smrtRead, readGroupId,
-                                            associatedRandInt, semaphores) == false) {
+            bool hasRead;
+            if (readPrefetcher != NULL) {
+                waitTimer.Tick();
+                hasRead = readPrefetcher->GetNext(smrtReads, readGroupId, associatedRandInt);
+                waitTimer.Tock(ReaderWaitStage);
+            } else {
+                hasRead = GetNextReadThroughSemaphore(*reader, params, smrtReads[0], readGroupId,
+                                                      associatedRandInt, semaphores,
+                                                      regionTableStream, regionTablePtr, telemetry);
+            }
+            if (hasRead == false) {
                 stop = true;
                 return false;
             } else {
-                smrtRead.SetQVScale(params.qvScaleType);
+                DropUnusedQualityValues(smrtReads[0], params);
+                smrtReads[0].SetQVScale(params.qvScaleType);
             }
         }
+        SMRTSequence &smrtRead = smrtReads[0];
 
         //
         // Only normal (non-CCS) reads should be masked.  Since CCS reads store the raw read, that is masked.
@@ -244,19 +262,29 @@ bool FetchReads(ReaderAgglomerate *reader, RegionTable *regionTablePtr, SMRTSequ
     } else {
         subreads.clear();
         std::vector<SMRTSequence> reads;
-        if (GetNextReadThroughSemaphore(*reader, params, reads, readGroupId, associatedRandInt,
-                                        semaphores) == false) {
+        bool hasReads;
+        if (readPrefetcher != NULL) {
+            waitTimer.Tick();
+            hasReads = readPrefetcher->GetNext(reads, readGroupId, associatedRandInt);
+            waitTimer.Tock(ReaderWaitStage);
+        } else {
+            hasReads =
+                GetNextReadThroughSemaphore(*reader, params, reads, readGroupId, associatedRandInt,
+                                            semaphores, NULL, NULL, telemetry);
+        }
+        if (hasReads == false) {
             stop = true;
             return false;
         }
 
-        for (const SMRTSequence &smrtRead : reads) {
+        for (SMRTSequence &smrtRead : reads) {
+            DropUnusedQualityValues(smrtRead, params);
             if (IsGoodRead(smrtRead, params, stop)) {
                 subreads.push_back(smrtRead);
             }
         }
         if (subreads.size() != 0) {
-            smrtRead.MadeFromSubreadsAsPolymerase(subreads);
+            smrtReads[0].MadeFromSubreadsAsPolymerase(subreads);
             return true;
         } else {
             return false;
@@ -327,8 +355,8 @@ void MapReadsNonCCS(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapDa
 
     for (int intvIndex = startIndex; intvIndex < endIndex; intvIndex++) {
         SMRTSequence subreadSequence, subreadSequenceRC;
-        MakeSubreadOfInterval(subreadSequence, smrtRead, subreadIntervals[intvIndex], params);
-        MakeSubreadRC(subreadSequenceRC, subreadSequence, smrtRead);
+        MakeSubreadViews(subreadSequence, subreadSequenceRC, smrtRead, smrtReadRC,
+                         subreadIntervals[intvIndex], params, mappingBuffers);
 
         //
         // Store the sequence that is being mapped in case no hits are
@@ -337,6 +365,7 @@ void MapReadsNonCCS(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapDa
         allReadAlignments.SetSequence(intvIndex, subreadSequence);
 
         std::vector<T_AlignmentCandidate *> alignmentPtrs;
+        std::vector<WeightedInterval> alignedIntervals;
         mapData->metrics.numReads++;
 
         assert(subreadSequence.zmwData.holeNumber == smrtRead.zmwData.holeNumber);
@@ -368,22 +397,32 @@ void MapReadsNonCCS(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapDa
                 // MapRead.  They are cleared though.
                 mapData,  // Some values that are shared
                 // across threads.
-                semaphores);
+                semaphores,
+                // The intervals aligned, so a sensitive pass can skip them.
+                params.doSensitiveSearch ? &alignedIntervals : NULL);
 
         //
         // No alignments were found, sometimes parameters are
         // specified to try really hard again to find an alignment.
         // This sets some parameters that use a more sensitive search
-        // at the cost of time.
+        // at the cost of time.  The sensitive pass keeps the alignments
+        // of the first, and only aligns the intervals the first did not.
         //
-
         if ((alignmentPtrs.size() == 0 or alignmentPtrs[0]->pctSimilarity < 80) and
             params.doSensitiveSearch) {
             MappingParameters sensitiveParams = params;
             sensitiveParams.SetForSensitivity();
+            std::vector<T_AlignmentCandidate *> sensitiveAlignmentPtrs;
             MapRead(subreadSequence, subreadSequenceRC, genome, sarray, *bwtPtr, seqBoundary, ct,
-                    seqdb, sensitiveParams, mapData->metrics, alignmentPtrs, mappingBuffers,
-                    mapData, semaphores);
+                    seqdb, sensitiveParams, mapData->metrics, sensitiveAlignmentPtrs,
+                    mappingBuffers, mapData, semaphores, &alignedIntervals);
+            if (sensitiveAlignmentPtrs.size() > 0) {
+                alignmentPtrs.insert(alignmentPtrs.end(), sensitiveAlignmentPtrs.begin(),
+                                     sensitiveAlignmentPtrs.end());
+                std::stable_sort(alignmentPtrs.begin(), alignmentPtrs.end(),
+                                 SortAlignmentPointersByScore());
+                RemoveOverlappingAlignments(alignmentPtrs, params);
+            }
         }
 
         //
@@ -402,8 +441,8 @@ void MapReadsNonCCS(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapDa
         allReadAlignments.AddAlignmentsForSeq(intvIndex, selectedAlignmentPtrs);
 
         //
-        // Move reference from subreadSequence, which will be freed at
-        // the end of this loop to the smrtRead, which exists for the
+        // Move reference from subreadSequence, whose bases are masked
+        // again at the end of this loop to the smrtRead, which exists for the
         // duration of aligning all subread of the smrtRead.
         //
         for (size_t a = 0; a < alignmentPtrs.size(); a++) {
@@ -421,18 +460,8 @@ void MapReadsNonCCS(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapDa
         // for printing
         // delete all AC which are in complement of SelectedAlignmemntPtrs vector
         // namely (SelectedAlignmentPtrs/alignmentPtrs)
-        for (size_t ii = 0; ii < alignmentPtrs.size(); ii++) {
-            int found = 0;
-            for (size_t jj = 0; jj < selectedAlignmentPtrs.size(); jj++) {
-                if (alignmentPtrs[ii] == selectedAlignmentPtrs[jj]) {
-                    found = 1;
-                    break;
-                }
-            }
-            if (found == 0) delete alignmentPtrs[ii];
-        }
-        subreadSequence.Free();
-        subreadSequenceRC.Free();
+        DeleteUnselectedAlignments(alignmentPtrs, selectedAlignmentPtrs);
+        ClearSubreadViews(subreadSequence, subreadSequenceRC, mappingBuffers);
     }  // End of looping over subread intervals within [startIndex, endIndex).
 
     if (params.verbosity >= 3) allReadAlignments.Print(threadOut);
@@ -440,6 +469,8 @@ void MapReadsNonCCS(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapDa
     // If not concordant , all done
 
     if (params.concordant) {
+        TelemetryTimer concordantTimer(mapData->telemetry);
+        concordantTimer.Tick();
         allReadAlignments.read = smrtRead;
         allReadAlignments.alignMode = ZmwSubreads;
 
@@ -498,7 +529,8 @@ void MapReadsNonCCS(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapDa
                     delete selectedAlignmentPtrs[alignmentIndex];
             }
         }  // End of if startIndex >= 0 and < subreadAlignments.size()
-    }      // End of if params.concordant
+        concordantTimer.Tock(ConcordantStage);
+    }  // End of if params.concordant
 }
 
 //
@@ -661,16 +693,7 @@ void MapReadsCCS(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapData,
     // for printing
     // delete all AC which are in complement of SelectedAlignmemntPtrs vector
     // namely (SelectedAlignmentPtrs/alignmentPtrs)
-    for (size_t ii = 0; ii < alignmentPtrs.size(); ii++) {
-        int found = 0;
-        for (size_t jj = 0; jj < selectedAlignmentPtrs.size(); jj++) {
-            if (alignmentPtrs[ii] == selectedAlignmentPtrs[jj]) {
-                found = 1;
-                break;
-            }
-        }
-        if (found == 0) delete alignmentPtrs[ii];
-    }
+    DeleteUnselectedAlignments(alignmentPtrs, selectedAlignmentPtrs);
 }
 
 void MapReads(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapData)
@@ -695,7 +718,10 @@ void MapReads(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapData)
 
     int numAligned = 0;
 
-    SMRTSequence smrtRead, smrtReadRC;
+    // The read is held in a vector so that the prefetch thread can
+    // swap its reads in (see FetchReads).
+    std::vector<SMRTSequence> smrtReads(1);
+    SMRTSequence smrtReadRC;
     SMRTSequence unrolledReadRC;
     CCSSequence ccsRead;
 
@@ -714,6 +740,15 @@ void MapReads(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapData)
     // fragmentation.
     //
     MappingBuffers mappingBuffers;
+
+    //
+    // When the region table is streamed, each thread only holds the
+    // regions of the zmw it is mapping.
+    //
+    RegionTable zmwRegionTable;
+    if (regionTableStream != NULL) {
+        mapData->regionTablePtr = &zmwRegionTable;
+    }
     while (true) {
         // Fetch reads from a zmw
         bool readIsCCS = false;
@@ -722,11 +757,16 @@ void MapReads(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapData)
         int associatedRandInt = 0;
         bool stop = false;
         std::vector<SMRTSequence> subreads;
-        bool readsOK =
-            FetchReads(mapData->reader, mapData->regionTablePtr, smrtRead, ccsRead, subreads,
-                       params, readIsCCS, alignmentContext.readGroupId, associatedRandInt, stop);
+        bool readsOK = FetchReads(mapData->reader, mapData->regionTablePtr, smrtReads, ccsRead,
+                                  subreads, params, readIsCCS, alignmentContext.readGroupId,
+                                  associatedRandInt, stop, mapData->telemetry);
         if (stop) break;
         if (not readsOK) continue;
+        SMRTSequence &smrtRead = smrtReads[0];
+
+        if (mapData->telemetry != NULL) {
+            mapData->telemetry->RecordRead(smrtRead.length);
+        }
 
         if (params.verbosity > 1) {
             std::cout << "aligning read: " << std::endl;
@@ -773,7 +813,7 @@ void MapReads(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapData)
 #ifdef USE_PBBAM
                                bamWriterPtr,
 #endif
-                               semaphores);
+                               semaphores, mapData->telemetry);
 
         allReadAlignments.Clear();
         smrtReadRC.Free();
@@ -788,11 +828,16 @@ void MapReads(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapData)
             mappingBuffers.Reset();
         }
     }  // End of while (true).
-    smrtRead.Free();
+    smrtReads[0].Free();
     smrtReadRC.Free();
     unrolledReadRC.Free();
     ccsRead.Free();
 
+    // This thread's core is now idle.
+    if (mapData->idleCores != NULL) {
+        mapData->idleCores->Release(1);
+    }
+
     if (params.nProc > 1) {
 #ifdef __APPLE__
         sem_wait(semaphores.reader);
@@ -1119,16 +1164,22 @@ int main(int argc, char *argv[])
     std::ofstream anchorFileStrm;
     std::ofstream clusterOut, *clusterOutPtr;
 
+    std::ios::openmode dumpMode = std::ios::out;
+    if (params.binaryDumps) {
+        dumpMode |= std::ios::binary;
+    }
     if (params.anchorFileName != "") {
-        CrucialOpen(params.anchorFileName, anchorFileStrm, std::ios::out);
+        CrucialOpen(params.anchorFileName, anchorFileStrm, dumpMode);
     }
 
     if (params.clusterFileName != "") {
-        CrucialOpen(params.clusterFileName, clusterOut, std::ios::out);
+        CrucialOpen(params.clusterFileName, clusterOut, dumpMode);
         clusterOutPtr = &clusterOut;
-        clusterOut << "total_size p_value n_anchors read_length align_score read_accuracy "
-                      "anchor_probability min_exp_anchors seq_length"
-                   << std::endl;
+        if (not params.binaryDumps) {
+            clusterOut << "total_size p_value n_anchors read_length align_score read_accuracy "
+                          "anchor_probability min_exp_anchors seq_length"
+                       << std::endl;
+        }
     } else {
         clusterOutPtr = NULL;
     }
@@ -1201,6 +1252,10 @@ int main(int argc, char *argv[])
     }
     //  In case the input is fasta, make all bases in upper case.
     reader->SetToUpper();
+    // Do not decode quality values that nothing downstream reads.
+    if (not params.needReadQuality and not params.needReadQVs) {
+        reader->SkipReadQuality();
+    }
 
     regionTableReader = new HDFRegionTableReader;
     RegionTable regionTable;
@@ -1323,8 +1378,22 @@ int main(int argc, char *argv[])
         //
         if (params.useRegionTable) {
             regionTable.Reset();
-            regionTableReader->ReadTable(regionTable);
-            regionTableReader->Close();
+            if (params.streamRegionTable) {
+                regionTableReader->Close();
+                std::string regionTableFileName =
+                    params.readSeparateRegionTable
+                        ? params.regionTableFileNames[params.readsFileIndex]
+                        : params.queryFileNames[params.readsFileIndex];
+                regionTableStream = new RegionTableStream;
+                if (regionTableStream->Initialize(regionTableFileName) == 0) {
+                    std::cout << "ERROR! Could not read the region table " << regionTableFileName
+                              << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+            } else {
+                regionTableReader->ReadTable(regionTable);
+                regionTableReader->Close();
+            }
         }
 
         //
@@ -1350,6 +1419,54 @@ int main(int argc, char *argv[])
             params.concordant = false;
         }
 
+        //
+        // Decode BAM records on a separate thread, so that the mapping
+        // threads do not serialize on inflating and converting reads.
+        //
+        if (params.prefetchReads > 0 and (reader->GetFileType() == FileType::PBBAM or
+                                          reader->GetFileType() == FileType::PBDATASET)) {
+            readPrefetcher = new ReadPrefetcher(reader, params.prefetchReads, params.concordant);
+            readPrefetcher->Start();
+        }
+
+        //
+        // Report throughput and per-stage timing while mapping.
+        //
+        MappingTelemetry *telemetry = NULL;
+        if (params.progressInterval > 0 or params.stageStatsFileName != "") {
+            telemetry = new MappingTelemetry(params.nProc, params.progressInterval,
+                                             params.stageStatsFileName);
+            telemetry->Start();
+        }
+
+        //
+        // Let long reads borrow the cores that mapping leaves idle.
+        //
+        IdleCores *idleCores = NULL;
+        if (params.intraReadThreads > 0) {
+            int numIdleCores = params.intraReadIdleCores;
+            if (numIdleCores < 0) {
+                numIdleCores = IdleCores::NumUnused(params.nProc);
+            }
+            idleCores = new IdleCores(numIdleCores);
+        }
+
+        //
+        // Buffer the anchor and cluster dumps per thread, and write them
+        // from a thread of their own.
+        //
+        DebugDumpWriter *anchorDumpWriter = NULL, *clusterDumpWriter = NULL;
+        if (params.binaryDumps and params.anchorFileName != "") {
+            anchorDumpWriter =
+                new DebugDumpWriter(params.nProc, &anchorFileStrm, DebugDump::AnchorRecord);
+            anchorDumpWriter->Start();
+        }
+        if (params.binaryDumps and params.clusterFileName != "") {
+            clusterDumpWriter =
+                new DebugDumpWriter(params.nProc, &clusterOut, DebugDump::ClusterRecord);
+            clusterDumpWriter->Start();
+        }
+
 #ifdef USE_GOOGLE_PROFILER
         char *profileFileName = getenv("CPUPROFILE");
         if (profileFileName != NULL) {
@@ -1364,6 +1481,16 @@ int main(int argc, char *argv[])
             mapdb[0].Initialize(&sarray, &genome, &seqdb, &ct, params, reader, &regionTable,
                                 outFilePtr, unalignedFilePtr, &anchorFileStrm, clusterOutPtr);
             mapdb[0].bwtPtr = &bwt;
+            if (telemetry != NULL) {
+                mapdb[0].telemetry = telemetry->ForThread(0);
+            }
+            mapdb[0].idleCores = idleCores;
+            if (anchorDumpWriter != NULL) {
+                mapdb[0].anchorDump = anchorDumpWriter->ForThread(0);
+            }
+            if (clusterDumpWriter != NULL) {
+                mapdb[0].clusterDump = clusterDumpWriter->ForThread(0);
+            }
             if (params.fullMetricsFileName != "") {
                 mapdb[0].metrics.SetStoreList(true);
             }
@@ -1386,6 +1513,16 @@ int main(int argc, char *argv[])
                                             &regionTable, outFilePtr, unalignedFilePtr,
                                             &anchorFileStrm, clusterOutPtr);
                 mapdb[procIndex].bwtPtr = &bwt;
+                if (telemetry != NULL) {
+                    mapdb[procIndex].telemetry = telemetry->ForThread(procIndex);
+                }
+                mapdb[procIndex].idleCores = idleCores;
+                if (anchorDumpWriter != NULL) {
+                    mapdb[procIndex].anchorDump = anchorDumpWriter->ForThread(procIndex);
+                }
+                if (clusterDumpWriter != NULL) {
+                    mapdb[procIndex].clusterDump = clusterDumpWriter->ForThread(procIndex);
+                }
                 if (params.fullMetricsFileName != "") {
                     mapdb[procIndex].metrics.SetStoreList(true);
                 }
@@ -1420,6 +1557,33 @@ int main(int argc, char *argv[])
                 threads = NULL;
             }
         }
+        if (telemetry != NULL) {
+            telemetry->Finish();
+            delete telemetry;
+            telemetry = NULL;
+        }
+        if (idleCores != NULL) {
+            delete idleCores;
+            idleCores = NULL;
+        }
+        if (anchorDumpWriter != NULL) {
+            anchorDumpWriter->Finish();
+            delete anchorDumpWriter;
+            anchorDumpWriter = NULL;
+        }
+        if (clusterDumpWriter != NULL) {
+            clusterDumpWriter->Finish();
+            delete clusterDumpWriter;
+            clusterDumpWriter = NULL;
+        }
+        if (readPrefetcher != NULL) {
+            delete readPrefetcher;
+            readPrefetcher = NULL;
+        }
+        if (regionTableStream != NULL) {
+            delete regionTableStream;
+            regionTableStream = NULL;
+        }
         reader->Close();
     }
 
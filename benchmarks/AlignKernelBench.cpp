@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../iblasr/BlasrHeaders.h"
+
+/*
+ * Times the alignment kernels used by blasr in isolation.  Pairs of
+ * sequences are given in two FASTA files, the i'th query paired with
+ * the i'th target (the same input as sdpMatcher).  Anchors of each pair
+ * are exact k-mer matches, found once before any kernel is timed.  The
+ * kernels are run with blasr's default parameters.
+ *
+ * Output is tabular: for each kernel the number of alignments, total
+ * seconds, nanoseconds per alignment, and the work done per second,
+ * measured in dynamic programming cells for the banded kernels, in
+ * query bases for SDPAlign, which finds its own k-mer matches, and in
+ * anchors for FindMaxIncreasingInterval and the anchor sorts.  The
+ * sorts (sortanchors: SortMatchPosList, radixanchors:
+ * RadixSortMatchPosList) order a copy of the anchors of each pair
+ * shuffled with a fixed seed; their checksum is taken from the sorted
+ * anchors after the timed runs.  guideduniform and extenduniform run
+ * guided and extend with UniformDistanceScoreFunction, as blasr does
+ * for the default score matrix, and extendinplace runs the extension
+ * of -extend, ExtendAlignmentInPlace.
+ */
+
+void PrintUsage()
+{
+    std::cout << "usage: alignKernelBench queries.fasta targets.fasta [-k k] [-repeat n] "
+                 "[-kernel name]..."
+              << std::endl
+              << "   kernels: sdp, kband, affinekband, guided, guideduniform, extend," << std::endl
+              << "            extenduniform, extendinplace, fmii, sortanchors, radixanchors"
+              << std::endl
+              << "            (default all)" << std::endl;
+}
+
+class KernelCase
+{
+public:
+    FASTASequence query;
+    DNASequence target;
+    std::vector<ChainedMatchPos> anchors;
+    std::vector<ChainedMatchPos> shuffledAnchors;
+    // Output of the anchor sorts.
+    std::vector<ChainedMatchPos> sortedAnchors;
+    // SDP alignment of the pair, the guide of GuidedAlign.
+    T_AlignmentCandidate guide;
+};
+
+//
+// Add the maximal exact matches of at least k bases between query and
+// target, with target positions offset by targetOffset.
+//
+void FindAnchors(DNASequence &query, DNASequence &target, int k, DNALength targetOffset,
+                 std::vector<ChainedMatchPos> &anchors)
+{
+    std::unordered_map<uint64_t, std::vector<DNALength> > targetKmers;
+    uint64_t mask = (k >= 32) ? ~uint64_t(0) : ((uint64_t(1) << (2 * k)) - 1);
+    uint64_t kmer = 0;
+    int valid = 0;
+    for (DNALength t = 0; t < target.length; t++) {
+        int nuc = ThreeBit[target.seq[t]];
+        if (nuc > 3) {
+            valid = 0;
+            continue;
+        }
+        kmer = ((kmer << 2) | nuc) & mask;
+        if (++valid >= k) {
+            targetKmers[kmer].push_back(t + 1 - k);
+        }
+    }
+
+    kmer = 0;
+    valid = 0;
+    for (DNALength q = 0; q < query.length; q++) {
+        int nuc = ThreeBit[query.seq[q]];
+        if (nuc > 3) {
+            valid = 0;
+            continue;
+        }
+        kmer = ((kmer << 2) | nuc) & mask;
+        if (++valid < k) {
+            continue;
+        }
+        DNALength qStart = q + 1 - k;
+        std::unordered_map<uint64_t, std::vector<DNALength> >::iterator it = targetKmers.find(kmer);
+        if (it == targetKmers.end()) {
+            continue;
+        }
+        for (size_t i = 0; i < it->second.size(); i++) {
+            DNALength tStart = it->second[i];
+            // Only report a match from its leftmost k-mer.
+            if (qStart > 0 and tStart > 0 and
+                ThreeBit[query.seq[qStart - 1]] == ThreeBit[target.seq[tStart - 1]]) {
+                continue;
+            }
+            DNALength l = k;
+            while (qStart + l < query.length and tStart + l < target.length and
+                   ThreeBit[query.seq[qStart + l]] == ThreeBit[target.seq[tStart + l]]) {
+                l++;
+            }
+            ChainedMatchPos anchor;
+            anchor.q = qStart;
+            anchor.t = tStart + targetOffset;
+            anchor.l = l;
+            anchors.push_back(anchor);
+        }
+    }
+}
+
+class KernelTiming
+{
+public:
+    std::string name;
+    std::string unit;
+    uint64_t numAlignments;
+    uint64_t work;
+    double seconds;
+    uint64_t checksum;
+
+    KernelTiming(const std::string &nameP, const std::string &unitP)
+        : name(nameP), unit(unitP), numAlignments(0), work(0), seconds(0), checksum(0)
+    {
+    }
+
+    void Print(std::ostream &out) const
+    {
+        out << name << "\t" << numAlignments << "\t" << seconds << "\t"
+            << (numAlignments > 0 ? seconds * 1e9 / numAlignments : 0) << "\t" << unit << "\t"
+            << (seconds > 0 ? work / seconds : 0) << "\t" << checksum << std::endl;
+    }
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+double SecondsSince(BenchClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        PrintUsage();
+        std::exit(EXIT_FAILURE);
+    }
+    std::string queryName = argv[1];
+    std::string targetName = argv[2];
+    int k = 12;
+    int repeat = 3;
+    std::vector<std::string> kernels;
+    int argi = 3;
+    while (argi < argc) {
+        if (strcmp(argv[argi], "-k") == 0 and argi + 1 < argc) {
+            k = atoi(argv[++argi]);
+        } else if (strcmp(argv[argi], "-repeat") == 0 and argi + 1 < argc) {
+            repeat = atoi(argv[++argi]);
+        } else if (strcmp(argv[argi], "-kernel") == 0 and argi + 1 < argc) {
+            kernels.push_back(argv[++argi]);
+        } else {
+            PrintUsage();
+            std::cout << "Bad option: " << argv[argi] << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        ++argi;
+    }
+    if (k < 4 or k > 32 or repeat < 1) {
+        std::cout << "ERROR, k must be in [4, 32] and repeat positive." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    if (kernels.empty()) {
+        const char *allKernels[] = {"sdp",           "kband",         "affinekband",
+                                    "guided",        "guideduniform", "extend",
+                                    "extenduniform", "extendinplace", "fmii",
+                                    "sortanchors",   "radixanchors"};
+        kernels.assign(allKernels, allKernels + 11);
+    }
+
+    // Defaults of blasr.  The guided kernels use the band of
+    // --guidedAlignBandSize, as GuidedAlign does when mapping.
+    MappingParameters params;
+
+    //
+    // The targets are read into one sequence so that the anchors of all
+    // cases index a single genome, as they do when mapping.
+    //
+    FASTAReader queryReader, targetReader;
+    if (!queryReader.Init(queryName) or !targetReader.Init(targetName)) {
+        std::cout << "ERROR, could not open " << queryName << " or " << targetName << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    T_GenomeSequence genome;
+    SequenceIndexDatabase<FASTQSequence> seqdb;
+    targetReader.ReadAllSequencesIntoOne(genome, &seqdb);
+    SeqBoundaryFtr<FASTQSequence> seqBoundary(&seqdb);
+
+    DistanceMatrixScoreFunction<DNASequence, FASTQSequence> distScoreFn(
+        SMRTDistanceMatrix, params.insertion, params.deletion);
+    UniformDistanceScoreFunction<DNASequence, FASTQSequence> uniformScoreFn(distScoreFn,
+                                                                            SMRTDistanceMatrix);
+    DistanceMatrixScoreFunction<DNASequence, DNASequence> sdpScoreFn(SMRTDistanceMatrix,
+                                                                     params.indel, params.indel);
+    // extendinplace reads the target strand in place.
+    DistanceMatrixScoreFunction<GenomeStrandView, FASTASequence> strandDistScoreFn(
+        SMRTDistanceMatrix, params.insertion, params.deletion);
+    UniformDistanceScoreFunction<GenomeStrandView, FASTASequence> strandUniformScoreFn(
+        strandDistScoreFn, SMRTDistanceMatrix);
+
+    std::vector<KernelCase *> cases;
+    FASTASequence query;
+    uint64_t totalAnchors = 0;
+    for (int caseIndex = 0; caseIndex < seqdb.nSeqPos - 1 and queryReader.GetNext(query);
+         caseIndex++) {
+        DNALength targetStart = seqdb.seqStartPos[caseIndex];
+        DNALength targetLength = seqdb.seqStartPos[caseIndex + 1] - 1 - targetStart;
+        if (query.length == 0 or targetLength == 0) {
+            continue;
+        }
+        cases.push_back(new KernelCase);
+        KernelCase &kc = *cases.back();
+        kc.query.Copy(query);
+        kc.target.ReferenceSubstring(genome, targetStart, targetLength);
+        FindAnchors(kc.query, kc.target, k, targetStart, kc.anchors);
+        SortMatchPosList(kc.anchors);
+        kc.shuffledAnchors = kc.anchors;
+        std::shuffle(kc.shuffledAnchors.begin(), kc.shuffledAnchors.end(), std::mt19937(caseIndex));
+        totalAnchors += kc.anchors.size();
+        SDPAlign(kc.query, kc.target, sdpScoreFn, params.sdpTupleSize, params.sdpIns, params.sdpDel,
+                 params.indelRate * 3, kc.guide, Local, params.detailedSDPAlignment,
+                 params.extendFrontAlignment, params.recurseOver);
+    }
+    std::cerr << "[INFO] " << cases.size() << " cases, " << totalAnchors << " anchors."
+              << std::endl;
+
+    MappingBuffers mappingBuffers;
+    std::cout << "kernel\talignments\tseconds\tnsPerAlignment\tunit\tunitsPerSecond\tchecksum"
+              << std::endl;
+    for (size_t kernelIndex = 0; kernelIndex < kernels.size(); kernelIndex++) {
+        const std::string &kernel = kernels[kernelIndex];
+        bool sortsAnchors = (kernel == "sortanchors" or kernel == "radixanchors");
+        std::string unit = "cells";
+        if (kernel == "sdp") {
+            unit = "bases";
+        } else if (kernel == "fmii" or sortsAnchors) {
+            unit = "anchors";
+        }
+        KernelTiming timing(kernel, unit);
+        BenchClock::time_point start = BenchClock::now();
+        for (int r = 0; r < repeat; r++) {
+            for (size_t c = 0; c < cases.size(); c++) {
+                KernelCase &kc = *cases[c];
+                T_AlignmentCandidate alignment;
+                int score = 0;
+                if (kernel == "sdp") {
+                    score = SDPAlign(kc.query, kc.target, sdpScoreFn, params.sdpTupleSize,
+                                     params.sdpIns, params.sdpDel, params.indelRate * 3, alignment,
+                                     Local, params.detailedSDPAlignment,
+                                     params.extendFrontAlignment, params.recurseOver);
+                    timing.work += kc.query.length;
+                } else if (kernel == "kband") {
+                    int band = std::abs(int(kc.query.length) - int(kc.target.length)) + k;
+                    score = KBandAlign(kc.query, kc.target, SMRTDistanceMatrix, params.indel + 2,
+                                       params.indel + 2, band, mappingBuffers.scoreMat,
+                                       mappingBuffers.pathMat, alignment, distScoreFn, Global);
+                    timing.work += uint64_t(kc.query.length) * (2 * band + 1);
+                } else if (kernel == "affinekband") {
+                    int band = std::abs(int(kc.query.length) - int(kc.target.length)) + k;
+                    score = AffineKBandAlign(
+                        kc.query, kc.target, SMRTDistanceMatrix, params.indel + 2, params.indel - 3,
+                        params.indel + 2, params.indel - 1, params.indel, band,
+                        mappingBuffers.scoreMat, mappingBuffers.pathMat,
+                        mappingBuffers.hpInsScoreMat, mappingBuffers.hpInsPathMat,
+                        mappingBuffers.insScoreMat, mappingBuffers.insPathMat, alignment, Global);
+                    timing.work += uint64_t(kc.query.length) * (2 * band + 1);
+                } else if (kernel == "guided") {
+                    if (kc.guide.blocks.empty()) {
+                        continue;
+                    }
+                    score = GuidedAlign(kc.query, kc.target, kc.guide, distScoreFn,
+                                        params.guidedAlignBandSize, mappingBuffers, alignment,
+                                        Global, false);
+                    timing.work += uint64_t(kc.guide.QEnd() - kc.guide.qPos) *
+                                   (2 * params.guidedAlignBandSize + 1);
+                } else if (kernel == "guideduniform") {
+                    if (kc.guide.blocks.empty()) {
+                        continue;
+                    }
+                    score = GuidedAlign(kc.query, kc.target, kc.guide, uniformScoreFn,
+                                        params.guidedAlignBandSize, mappingBuffers, alignment,
+                                        Global, false);
+                    timing.work += uint64_t(kc.guide.QEnd() - kc.guide.qPos) *
+                                   (2 * params.guidedAlignBandSize + 1);
+                } else if (kernel == "extend") {
+                    score = ExtendAlignmentForward(
+                        kc.query, 0, kc.target, 0, params.extendBandSize, mappingBuffers.scoreMat,
+                        mappingBuffers.pathMat, alignment, distScoreFn, 1, params.maxExtendDropoff);
+                    timing.work += uint64_t(kc.query.length) * (2 * params.extendBandSize + 1);
+                } else if (kernel == "extenduniform") {
+                    score = ExtendAlignmentForward(kc.query, 0, kc.target, 0, params.extendBandSize,
+                                                   mappingBuffers.scoreMat, mappingBuffers.pathMat,
+                                                   alignment, uniformScoreFn, 1,
+                                                   params.maxExtendDropoff);
+                    timing.work += uint64_t(kc.query.length) * (2 * params.extendBandSize + 1);
+                } else if (kernel == "extendinplace") {
+                    GenomeStrandView target(kc.target.seq, kc.target.length, false);
+                    DNALength qExtendLength, tExtendLength;
+                    alignment.blocks.clear();
+                    score = DispatchDistanceScoreFunction(
+                        strandUniformScoreFn, strandDistScoreFn, [&](auto &scoreFn) {
+                            return ExtendAlignmentInPlace(
+                                kc.query, 0, kc.query.length, target, 0, kc.target.length, 1,
+                                params.extendBandSize, scoreFn, params.maxExtendDropoff,
+                                mappingBuffers.extensionBuffers, alignment.blocks, qExtendLength,
+                                tExtendLength);
+                        });
+                    timing.work += uint64_t(kc.query.length) * (2 * params.extendBandSize + 1);
+                } else if (kernel == "fmii") {
+                    WeightedIntervalSet topIntervals(params.nCandidates);
+                    MultiplicityPValueWeightor lisPValueByWeight(genome);
+                    LISSizeWeightor<std::vector<ChainedMatchPos> > lisWeightFn;
+                    IntervalSearchParameters intervalSearchParameters;
+                    intervalSearchParameters.maxPValue = log(0.5);
+                    intervalSearchParameters.aboveCategoryPValue = -300;
+                    VarianceAccumulator<float> accumPValue, accumWeight, accumNBases;
+                    mappingBuffers.matchPosList = kc.anchors;
+                    mappingBuffers.clusterList.Clear();
+                    FindMaxIncreasingInterval(
+                        Forward, mappingBuffers.matchPosList,
+                        (DNALength)(kc.query.length * (1 + params.indelRate)), params.nCandidates,
+                        seqBoundary, lisPValueByWeight, lisWeightFn, topIntervals, genome, kc.query,
+                        intervalSearchParameters, &mappingBuffers.globalChainEndpointBuffer,
+                        mappingBuffers.clusterList, accumPValue, accumWeight, accumNBases);
+                    score = topIntervals.size();
+                    timing.work += kc.anchors.size();
+                } else if (sortsAnchors) {
+                    kc.sortedAnchors = kc.shuffledAnchors;
+                    if (kernel == "sortanchors") {
+                        SortMatchPosList(kc.sortedAnchors);
+                    } else {
+                        RadixSortMatchPosList(kc.sortedAnchors, mappingBuffers.matchPosSortBuffers);
+                    }
+                    timing.work += kc.anchors.size();
+                } else {
+                    std::cout << "ERROR, unknown kernel " << kernel << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+                timing.checksum += uint64_t(score);
+                timing.numAlignments++;
+            }
+        }
+        timing.seconds = SecondsSince(start);
+        if (sortsAnchors) {
+            // Differs between the sorts if they order anchors differently.
+            for (size_t c = 0; c < cases.size(); c++) {
+                const std::vector<ChainedMatchPos> &sorted = cases[c]->sortedAnchors;
+                for (size_t a = 0; a < sorted.size(); a++) {
+                    timing.checksum += uint64_t(a + 1) * (sorted[a].q & 0xff);
+                }
+            }
+        }
+        timing.Print(std::cout);
+    }
+
+    for (size_t c = 0; c < cases.size(); c++) {
+        cases[c]->query.Free();
+        delete cases[c];
+    }
+    genome.Free();
+    return 0;
+}
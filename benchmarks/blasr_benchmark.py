@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""Time one blasr mapping mode on a synthetic data set and report it as JSON.
+
+The data set is made once per work directory and reused by every mode:
+
+  1. a random reference is written from a fixed seed,
+  2. evolve mutates it into a sample genome (-nonRandInit),
+  3. simpleShredder samples reads from the sample genome (-nonRandInit),
+  4. sawriter builds the suffix array of the reference.
+
+blasr is then run with the mode's options and --stageStats, and the wall
+time, reads/sec, bases/sec, peak RSS of the blasr process and the time of
+each mapping stage summed over threads are printed as one JSON object.
+
+With --kernel-bench, blasr is not run.  Instead pieces of the reference
+are cut with simpleShredder and mutated with evolve, and the pairs are
+given to alignKernelBench, which times each alignment kernel alone.
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import time
+
+
+def run(cmd, **kwargs):
+    print("+ " + " ".join(cmd), file=sys.stderr)
+    subprocess.check_call(cmd, **kwargs)
+
+
+def write_reference(path, seed, num_contigs, contig_length):
+    rng = random.Random(seed)
+    with open(path + ".tmp", "w") as out:
+        for contig in range(num_contigs):
+            out.write(">ref{:06d}\n".format(contig + 1))
+            for start in range(0, contig_length, 70):
+                length = min(70, contig_length - start)
+                out.write("".join(rng.choice("ACGT") for _ in range(length)) + "\n")
+    os.rename(path + ".tmp", path)
+
+
+def make_data_set(args):
+    os.makedirs(args.workdir, exist_ok=True)
+    ref = os.path.join(args.workdir, "reference.fasta")
+    sample = os.path.join(args.workdir, "sample.fasta")
+    reads = os.path.join(args.workdir, "reads.fasta")
+    sa = ref + ".sa"
+
+    if not os.path.exists(ref):
+        write_reference(ref, args.seed, args.contigs, args.contig_length)
+    if not os.path.exists(sample):
+        run([args.evolve, ref, sample + ".tmp",
+             "-i", str(args.ins_rate), "-d", str(args.del_rate), "-m", str(args.mut_rate),
+             "-nonRandInit"])
+        os.rename(sample + ".tmp", sample)
+    if not os.path.exists(reads):
+        run([args.shredder, "-inFile", sample, "-readsFile", reads + ".tmp",
+             "-readLength", str(args.read_length), "-coverage", str(args.coverage),
+             "-nonRandInit"])
+        os.rename(reads + ".tmp", reads)
+    if not os.path.exists(sa):
+        run([args.sawriter, sa + ".tmp", ref])
+        os.rename(sa + ".tmp", sa)
+    return ref, reads, sa
+
+
+def make_kernel_cases(args, ref):
+    targets = os.path.join(args.workdir, "kernel_targets.fasta")
+    queries = os.path.join(args.workdir, "kernel_queries.fasta")
+    if not os.path.exists(targets):
+        run([args.shredder, "-inFile", ref, "-readsFile", targets + ".tmp",
+             "-readLength", str(args.kernel_length), "-nReads", str(args.kernel_cases),
+             "-nonRandInit"])
+        os.rename(targets + ".tmp", targets)
+    if not os.path.exists(queries):
+        run([args.evolve, targets, queries + ".tmp",
+             "-i", str(args.ins_rate), "-d", str(args.del_rate), "-m", str(args.mut_rate),
+             "-nonRandInit"])
+        os.rename(queries + ".tmp", queries)
+    return queries, targets
+
+
+def run_kernels(args, ref):
+    queries, targets = make_kernel_cases(args, ref)
+    cmd = [args.kernel_bench, queries, targets]
+    print("+ " + " ".join(cmd), file=sys.stderr)
+    table = subprocess.check_output(cmd, universal_newlines=True).splitlines()
+    header = table[0].split("\t")
+    kernels = {}
+    for line in table[1:]:
+        fields = dict(zip(header, line.split("\t")))
+        kernels[fields["kernel"]] = {
+            "alignments": int(fields["alignments"]),
+            "seconds": float(fields["seconds"]),
+            "nsPerAlignment": float(fields["nsPerAlignment"]),
+            fields["unit"] + "PerSecond": float(fields["unitsPerSecond"]),
+        }
+    return {"name": args.name, "command": cmd, "kernels": kernels}
+
+
+def read_stage_stats(path):
+    """Sum the per-thread tables written by blasr --stageStats."""
+    totals = {"reads": 0, "bases": 0, "bytesWritten": 0}
+    stages = {}
+    header = None
+    with open(path) as stats:
+        for line in stats:
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) < 2:
+                header = None
+            elif fields[0] == "thread":
+                header = fields
+            elif header is not None and header[1] == "reads":
+                for key in totals:
+                    totals[key] += int(fields[header.index(key)])
+            elif header is not None and header[1] == "stage":
+                stage = stages.setdefault(fields[1], {"count": 0, "seconds": 0.0, "maxus": 0})
+                stage["count"] += int(fields[header.index("count")])
+                stage["seconds"] += float(fields[header.index("seconds")])
+                stage["maxus"] = max(stage["maxus"], int(fields[header.index("maxus")]))
+    return totals, stages
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--name", required=True, help="Name of the benchmark.")
+    parser.add_argument("--blasr", required=True)
+    parser.add_argument("--sawriter", required=True)
+    parser.add_argument("--kernel-bench", help="Time alignment kernels with this alignKernelBench.")
+    parser.add_argument("--kernel-cases", type=int, default=400)
+    parser.add_argument("--kernel-length", type=int, default=1000)
+    parser.add_argument("--evolve", required=True)
+    parser.add_argument("--shredder", required=True)
+    parser.add_argument("--workdir", required=True,
+                        help="Where the synthetic data set is made and reused.")
+    parser.add_argument("--json", help="Also write the result to this file.")
+    parser.add_argument("--reads",
+                        help="Map these reads (e.g. a bam or bax.h5 fofn) instead of the "
+                             "synthetic ones.")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--contigs", type=int, default=4)
+    parser.add_argument("--contig-length", type=int, default=500000)
+    parser.add_argument("--ins-rate", type=float, default=0.08)
+    parser.add_argument("--del-rate", type=float, default=0.04)
+    parser.add_argument("--mut-rate", type=float, default=0.02)
+    parser.add_argument("--read-length", type=int, default=4000)
+    parser.add_argument("--coverage", type=float, default=8)
+    parser.add_argument("blasr_args", nargs=argparse.REMAINDER,
+                        help="Options of the mode, after --.")
+    args = parser.parse_args()
+
+    ref, reads, sa = make_data_set(args)
+    if args.kernel_bench:
+        return write_result(args, run_kernels(args, ref))
+    if args.reads:
+        reads = args.reads
+    blasr_args = [a for a in args.blasr_args if a != "--"]
+
+    out = os.path.join(args.workdir, args.name + ".out")
+    stats = os.path.join(args.workdir, args.name + ".stats")
+    cmd = [args.blasr, reads, ref, "--sa", sa, "--out", out, "--stageStats", stats] + blasr_args
+    print("+ " + " ".join(cmd), file=sys.stderr)
+
+    start = time.monotonic()
+    # Wait on this pid alone so that the rusage covers only this run.
+    blasr = subprocess.Popen(cmd)
+    _, status, usage = os.wait4(blasr.pid, 0)
+    blasr.returncode = status
+    seconds = time.monotonic() - start
+    if not os.WIFEXITED(status) or os.WEXITSTATUS(status) != 0:
+        print("ERROR, blasr failed with wait status {}".format(status), file=sys.stderr)
+        return 1
+
+    totals, stages = read_stage_stats(stats)
+    result = {
+        "name": args.name,
+        "command": cmd,
+        "wallSeconds": seconds,
+        "userSeconds": usage.ru_utime,
+        "systemSeconds": usage.ru_stime,
+        # ru_maxrss is in kilobytes on Linux and bytes on macOS.
+        "peakRssBytes": usage.ru_maxrss * (1 if sys.platform == "darwin" else 1024),
+        "reads": totals["reads"],
+        "bases": totals["bases"],
+        "bytesWritten": totals["bytesWritten"],
+        "readsPerSecond": totals["reads"] / seconds,
+        "basesPerSecond": totals["bases"] / seconds,
+        "stages": stages,
+    }
+    return write_result(args, result)
+
+
+def write_result(args, result):
+    text = json.dumps(result, indent=2, sort_keys=True)
+    print(text)
+    if args.json:
+        with open(args.json, "w") as out_json:
+            out_json.write(text + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
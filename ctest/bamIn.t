@@ -17,5 +17,45 @@ Test bam in, bam out
   [INFO]* (glob)
   [INFO]* (glob)
 
+Check whether decoding bam reads on a prefetch thread produces identical results
+  $ $BLASR_EXE $DATDIR/test_bam/tiny_bam.fofn $DATDIR/lambda_ref.fasta -m 4 --nproc 4 --prefetch 64 --out $OUTDIR/tiny_bam_in_prefetch.m4
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ sort $OUTDIR/tiny_bam_in.m4 > $TMP1.bam_in_sorted
+  $ sort $OUTDIR/tiny_bam_in_prefetch.m4 > $TMP2.bam_in_prefetch_sorted
+  $ diff $TMP1.bam_in_sorted $TMP2.bam_in_prefetch_sorted
+
+Check that per-stage statistics are written without changing the alignments
+  $ $BLASR_EXE $DATDIR/test_bam/tiny_bam.fofn $DATDIR/lambda_ref.fasta -m 4 --nproc 4 --stageStats $OUTDIR/tiny_bam_in.stats --out $OUTDIR/tiny_bam_in_stats.m4
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ sort $OUTDIR/tiny_bam_in_stats.m4 | diff $TMP1.bam_in_sorted -
+  $ head -n 1 $OUTDIR/tiny_bam_in.stats
+  thread	reads	bases	bytesWritten	elapsedSeconds (esc)
+  $ grep -c "seeding" $OUTDIR/tiny_bam_in.stats
+  4
+
+Check that mapping reads with idle cores produces identical results
+  $ $BLASR_EXE $DATDIR/test_bam/tiny_bam.fofn $DATDIR/lambda_ref.fasta -m 4 --intraReadThreads 3 --intraReadMinLength 0 --out $OUTDIR/tiny_bam_in_intraread.m4
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ sort $OUTDIR/tiny_bam_in_intraread.m4 | diff $TMP1.bam_in_sorted -
+
+Check that binary cluster dumps decode to the text dump
+  $ $BLASR_EXE $DATDIR/test_bam/tiny_bam.fofn $DATDIR/lambda_ref.fasta -m 4 --clusters $OUTDIR/tiny_bam_in.clusters --out $TMP1.clusters.m4
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ $BLASR_EXE $DATDIR/test_bam/tiny_bam.fofn $DATDIR/lambda_ref.fasta -m 4 --clusters $OUTDIR/tiny_bam_in.clusters.bin --binaryDumps --out $TMP2.clusters.m4
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ $BLASR_DUMP_DECODE_EXE $OUTDIR/tiny_bam_in.clusters.bin | diff $OUTDIR/tiny_bam_in.clusters -
+
+An empty cluster dump still decodes to the header of the text dump
+  $ $BLASR_EXE $DATDIR/test_bam/tiny_bam.fofn $DATDIR/lambda_ref.fasta -m 4 --minReadLength 100000000 --clusters $OUTDIR/tiny_bam_in_empty.clusters.bin --binaryDumps --out $TMP2.empty.m4
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ $BLASR_DUMP_DECODE_EXE $OUTDIR/tiny_bam_in_empty.clusters.bin
+  total_size p_value n_anchors read_length align_score read_accuracy anchor_probability min_exp_anchors seq_length
+
 TODO: test --concordant, when pbbam API to query over ZMWs is available.
 TODO: test bam with ccs reads
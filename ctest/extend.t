@@ -0,0 +1,39 @@
+Set up
+  $ mkdir -p $OUTDIR
+
+Split lambda into two contigs at 24000, and make reads from it whose first
+and last 64 bases have a mismatch every 8 bases, so that no anchor covers
+them and only --extend aligns them.  The reads are
+  fwd             lambda 10000-12000
+  rev             the reverse complement of lambda 30000-32000
+  fwdContigEnd    lambda 22000-24000, then 40 bases of the next contig
+  revContigEnd    the reverse complement of fwdContigEnd
+  fwdContigStart  40 bases of the previous contig, then lambda 24000-26000
+The extensions of the last three must stop at the end of their contig.
+  $ L=$OUTDIR/extend_lambda.seq
+  $ grep -v ">" $DATDIR/lambda_ref.fasta | tr -d '\n' | tr acgt ACGT > $L
+  $ sub() { cut -c $(($1 + 1))-$2 $L; }
+  $ rc() { rev | tr ACGT TGCA; }
+  $ noisy() { sub $1 $2 | awk 'BEGIN { c["A"] = "T"; c["C"] = "G"; c["G"] = "C"; c["T"] = "A" } { n = length($0); s = ""; for (i = 0; i < n; i++) { b = substr($0, i + 1, 1); if ((i < 64 && i % 8 == 3) || (i >= n - 64 && (i - n + 64) % 8 == 4)) b = c[b]; s = s b } print s }'; }
+  $ T=$OUTDIR/extend_ref.fasta
+  $ (echo ">part1"; sub 0 24000; echo ">part2"; cut -c 24001- $L) > $T
+  $ Q=$OUTDIR/extend_reads.fasta
+  $ echo ">fwd" > $Q; noisy 10000 12000 >> $Q
+  $ echo ">rev" >> $Q; noisy 30000 32000 | rc >> $Q
+  $ echo ">fwdContigEnd" >> $Q; echo $(noisy 22000 24000)$(sub 24000 24040) >> $Q
+  $ echo ">revContigEnd" >> $Q; echo $(noisy 22000 24000)$(sub 24000 24040) | rc >> $Q
+  $ echo ">fwdContigStart" >> $Q; echo $(sub 23960 24000)$(noisy 24000 26000) >> $Q
+
+Extend the alignments over the noisy ends, in forward and reverse strand
+coordinates, up to the contig boundaries.
+  $ O=$OUTDIR/extend.sam
+  $ $BLASR_EXE $Q $T --sam --out $O --bestn 1 --nproc 1 --extend && echo $?
+  [INFO]* (glob)
+  [INFO]* (glob)
+  0
+  $ grep -v "^@" $O | cut -f 2-4,6
+  0\tpart1\t10001\t3=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X1880=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X3= (esc)
+  16\tpart2\t6001\t3=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X1880=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X3= (esc)
+  0\tpart1\t22001\t3=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X1880=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X3=40S (esc)
+  16\tpart1\t22001\t3=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X1880=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X3=40S (esc)
+  0\tpart2\t1\t40S3=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X1880=1X7=1X7=1X7=1X7=1X7=1X7=1X7=1X3= (esc)
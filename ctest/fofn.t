@@ -16,3 +16,10 @@ Test blasr with *.fofn input
   [INFO]* (glob)
   $ sort $OUTDIR/lambda_bax_tmp_subset.m4 > $OUTDIR/lambda_bax_subset.m4
   $ diff $OUTDIR/lambda_bax_subset.m4 $STDDIR/lambda_bax_subset.m4
+
+Test streaming the region table along with the reads
+  $ $BLASR_EXE $DATDIR/lambda_bax.fofn $DATDIR/lambda_ref.fasta -m 4 --out $OUTDIR/lambda_bax_tmp_stream.m4 --nproc 15 --minMatch 14 --holeNumbers 1--1000 --sa $DATDIR/lambda_ref.sa --streamRegionTable
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ sort $OUTDIR/lambda_bax_tmp_stream.m4 > $OUTDIR/lambda_bax_stream.m4
+  $ diff $OUTDIR/lambda_bax_stream.m4 $STDDIR/lambda_bax_subset.m4
@@ -0,0 +1,25 @@
+Set up
+  $ mkdir -p $OUTDIR
+
+Make a read from a stretch of lambda followed by the reverse complement of
+another stretch, so that it has anchors and top intervals on both strands.
+  $ grep -v ">" $DATDIR/lambda_ref.fasta | tr -d '\n' > $OUTDIR/intraRead_lambda.seq
+  $ echo ">bothStrands" > $OUTDIR/intraRead_bothStrands.fasta
+  $ cut -c 5001-9000 $OUTDIR/intraRead_lambda.seq >> $OUTDIR/intraRead_bothStrands.fasta
+  $ cut -c 30001-34000 $OUTDIR/intraRead_lambda.seq | rev | tr ACGTacgt TGCAtgca >> $OUTDIR/intraRead_bothStrands.fasta
+
+Map it with a single thread, then with helpers from three idle cores, however
+many cores this host has.  The helpers seed the reverse strand and align part
+of the intervals, and the alignments must not change.
+  $ $BLASR_EXE $OUTDIR/intraRead_bothStrands.fasta $DATDIR/lambda_ref.fasta -m 4 --bestn 10 --nproc 1 --out $OUTDIR/intraRead_sequential.m4
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ $BLASR_EXE $OUTDIR/intraRead_bothStrands.fasta $DATDIR/lambda_ref.fasta -m 4 --bestn 10 --nproc 1 --intraReadThreads 3 --intraReadMinLength 0 --intraReadIdleCores 3 --out $OUTDIR/intraRead_helpers.m4
+  [INFO]* (glob)
+  [INFO]* (glob)
+  $ diff $OUTDIR/intraRead_sequential.m4 $OUTDIR/intraRead_helpers.m4
+
+Both strands are aligned.
+  $ cut -d " " -f 9 $OUTDIR/intraRead_sequential.m4 | sort -u
+  0
+  1
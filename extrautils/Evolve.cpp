@@ -33,6 +33,7 @@ int main(int argc, char* argv[])
     float delRate = 0;
     float mutRate = 0;
     bool lower = false;
+    bool noRandInit = false;
     gffFileName = "";
     clp.RegisterStringOption("refGenome", &refGenomeName, "Reference genome.", true);
     clp.RegisterStringOption("mutGenome", &mutGenomeName, "Mutated genome.", true);
@@ -46,6 +47,8 @@ int main(int argc, char* argv[])
     clp.RegisterFloatOption("m", &mutRate, "Mutation rate, even across all nucleotides: (0-1]",
                             CommandLineParser::NonNegativeFloat, false);
     clp.RegisterFlagOption("lower", &lower, "Make mutations in lower case", false);
+    clp.RegisterFlagOption("nonRandInit", &noRandInit,
+                           "Skip initializing the random number generator with time.");
     std::vector<std::string> leftovers;
     clp.ParseCommandLine(argc, argv, leftovers);
 
@@ -62,7 +65,9 @@ int main(int argc, char* argv[])
 
     std::vector<int> insIndices, delIndices, subIndices;
     int readIndex = 0;
-    InitializeRandomGeneratorWithTime();
+    if (!noRandInit) {
+        InitializeRandomGeneratorWithTime();
+    }
     while (reader.GetNext(refGenome)) {
         insIndices.resize(refGenome.length);
         delIndices.resize(refGenome.length);
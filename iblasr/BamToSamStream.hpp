@@ -0,0 +1,208 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include <pbbam/BamReader.h>
+#include <pbbam/BamRecord.h>
+#include <pbbam/SamWriter.h>
+
+//
+// Decode a BAM file into SAM text for readers that only parse SAM.
+// The records are decoded on a thread of their own and written
+// through a named pipe, so the BAM file is read alongside the reader
+// rather than being converted to a SAM file first.  Open SamFileName()
+// with a SAM reader after Initialize succeeds, and call Close once the
+// reader is done, whether or not it read to the end; Close reports
+// whether every record was decoded.
+//
+class BamToSamStream
+{
+public:
+    BamToSamStream();
+
+    ~BamToSamStream();
+
+    // Open a BAM file and start decoding it.  Returns 0 on failure.
+    int Initialize(const std::string &bamFileNameP);
+
+    const std::string &SamFileName() const;
+
+    // Stop decoding, wait for the decoding thread and remove the pipe.
+    // Returns 0 if a record could not be decoded, after printing why.
+    int Close();
+
+private:
+    std::string bamFileName;
+    std::string pipeDirName;
+    std::string pipeFileName;
+    PacBio::BAM::BamReader *reader;
+    pthread_t thread;
+    bool isRunning;
+    // Set by Close to stop decoding, and by the thread when it is done.
+    std::atomic<bool> isStopping;
+    std::atomic<bool> isDone;
+    // Why decoding failed, if it did; read once the thread is joined.
+    std::string errorMessage;
+
+    static void *Decode(void *streamP);
+};
+
+inline BamToSamStream::BamToSamStream()
+    : reader(NULL), isRunning(false), isStopping(false), isDone(false)
+{
+}
+
+inline BamToSamStream::~BamToSamStream() { Close(); }
+
+inline int BamToSamStream::Initialize(const std::string &bamFileNameP)
+{
+    Close();
+    bamFileName = bamFileNameP;
+
+    //
+    // Open the BAM file here, so that a file that can not be read is
+    // reported before anything waits on the pipe.
+    //
+    try {
+        reader = new PacBio::BAM::BamReader(bamFileName);
+    } catch (std::exception &e) {
+        std::cout << "ERROR, could not read " << bamFileName << ": " << e.what() << std::endl;
+        return 0;
+    }
+
+    const char *tmpDir = std::getenv("TMPDIR");
+    std::string pipeDirTemplate = std::string(tmpDir != NULL ? tmpDir : "/tmp") + "/bam2sam.XXXXXX";
+    if (mkdtemp(&pipeDirTemplate[0]) == NULL) {
+        std::cout << "ERROR, could not create a temporary directory for " << bamFileName
+                  << std::endl;
+        delete reader;
+        reader = NULL;
+        return 0;
+    }
+    pipeDirName = pipeDirTemplate;
+    pipeFileName = pipeDirName + "/records.sam";
+    if (mkfifo(pipeFileName.c_str(), 0600) != 0) {
+        std::cout << "ERROR, could not create a pipe for " << bamFileName << std::endl;
+        rmdir(pipeDirName.c_str());
+        delete reader;
+        reader = NULL;
+        return 0;
+    }
+
+    isStopping = false;
+    isDone = false;
+    errorMessage = "";
+    if (pthread_create(&thread, NULL, Decode, this) != 0) {
+        std::cout << "ERROR, could not start a thread to decode " << bamFileName << std::endl;
+        unlink(pipeFileName.c_str());
+        rmdir(pipeDirName.c_str());
+        pipeFileName = "";
+        pipeDirName = "";
+        delete reader;
+        reader = NULL;
+        return 0;
+    }
+    isRunning = true;
+    return 1;
+}
+
+inline const std::string &BamToSamStream::SamFileName() const { return pipeFileName; }
+
+inline int BamToSamStream::Close()
+{
+    if (isRunning) {
+        //
+        // The thread may be waiting for a reader to open the pipe, or
+        // for one to make room in it, if the SAM reader stopped early.
+        // Hold the read end open and drain it until the thread is
+        // done, so that it sees the stop and never writes to a pipe
+        // without a reader.
+        //
+        isStopping = true;
+        int pipeFd = open(pipeFileName.c_str(), O_RDONLY | O_NONBLOCK);
+        if (pipeFd >= 0) {
+            fcntl(pipeFd, F_SETFL, fcntl(pipeFd, F_GETFL) & ~O_NONBLOCK);
+            char drained[65536];
+            while (not isDone) {
+                // Without a writer this returns 0 at once, until the
+                // thread opens the pipe or finishes.
+                if (read(pipeFd, drained, sizeof(drained)) <= 0) {
+                    usleep(1000);
+                }
+            }
+            close(pipeFd);
+        }
+        pthread_join(thread, NULL);
+        isRunning = false;
+    }
+    if (reader != NULL) {
+        delete reader;
+        reader = NULL;
+    }
+    if (pipeFileName != "") {
+        unlink(pipeFileName.c_str());
+        rmdir(pipeDirName.c_str());
+        pipeFileName = "";
+        pipeDirName = "";
+    }
+    if (errorMessage != "") {
+        std::cout << errorMessage << std::endl;
+        errorMessage = "";
+        return 0;
+    }
+    return 1;
+}
+
+//
+// Opening the pipe for writing blocks until the SAM reader opens it,
+// and the writer is closed at the end so the reader sees end of file.
+// Errors are kept for Close to report, since the reading thread owns
+// the exit; the pipe is still opened and closed once so that a reader
+// waiting to open it sees end of file.
+//
+inline void *BamToSamStream::Decode(void *streamP)
+{
+    BamToSamStream *stream = (BamToSamStream *)streamP;
+
+    // A reader that goes away makes writes fail, instead of raising
+    // SIGPIPE on the whole process.
+    sigset_t pipeSignal;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, NULL);
+
+    bool isOpened = false;
+    try {
+        PacBio::BAM::SamWriter writer(stream->pipeFileName, stream->reader->Header());
+        isOpened = true;
+        PacBio::BAM::BamRecord record;
+        while (not stream->isStopping and stream->reader->GetNext(record)) {
+            writer.Write(record);
+        }
+    } catch (std::exception &e) {
+        if (not stream->isStopping) {
+            stream->errorMessage =
+                "ERROR, could not decode " + stream->bamFileName + ": " + e.what();
+        }
+    }
+    if (not isOpened) {
+        int pipeFd = open(stream->pipeFileName.c_str(), O_WRONLY);
+        if (pipeFd >= 0) {
+            close(pipeFd);
+        }
+    }
+    stream->isDone = true;
+    return NULL;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+//
+// Converts batches of records on a pool of threads while the thread
+// that started a batch goes on, so that converting one batch overlaps
+// with reading the next and writing the previous one.
+// convert(input, output) converts a single record.  Each thread calls
+// its own copy of convert, so state that convert captures by value is
+// per thread; what it captures by reference must be safe to read from
+// several threads at once.  Outputs are stored by the index of their
+// input, so they can be written in input order.
+//
+template <typename T_Input, typename T_Output, typename T_Convert>
+class BatchConverter
+{
+public:
+    BatchConverter(T_Convert &convertP, int numThreadsP);
+
+    ~BatchConverter();
+
+    // Start converting inputs[i] into outputs[i].
+    void Start(std::vector<T_Input> &inputs, std::vector<T_Output> &outputs);
+
+    // Wait until the batch started last is converted.
+    void Wait();
+
+private:
+    class ThreadArgs
+    {
+    public:
+        BatchConverter *converter;
+        int threadIndex;
+    };
+
+    std::vector<T_Convert> converts;
+    int numThreads;
+    bool running;
+    std::vector<T_Input> *inputs;
+    std::vector<T_Output> *outputs;
+    std::vector<ThreadArgs> args;
+    std::vector<pthread_t> threads;
+
+    static void *ConvertRange(void *argsP);
+};
+
+template <typename T_Input, typename T_Output, typename T_Convert>
+BatchConverter<T_Input, T_Output, T_Convert>::BatchConverter(T_Convert &convertP, int numThreadsP)
+    : converts(numThreadsP, convertP)
+    , numThreads(numThreadsP)
+    , running(false)
+    , inputs(NULL)
+    , outputs(NULL)
+    , args(numThreadsP)
+    , threads(numThreadsP)
+{
+    for (int t = 0; t < numThreads; t++) {
+        args[t].converter = this;
+        args[t].threadIndex = t;
+    }
+}
+
+template <typename T_Input, typename T_Output, typename T_Convert>
+BatchConverter<T_Input, T_Output, T_Convert>::~BatchConverter()
+{
+    Wait();
+}
+
+template <typename T_Input, typename T_Output, typename T_Convert>
+void BatchConverter<T_Input, T_Output, T_Convert>::Start(std::vector<T_Input> &inputsP,
+                                                         std::vector<T_Output> &outputsP)
+{
+    assert(not running);
+    inputs = &inputsP;
+    outputs = &outputsP;
+    outputs->resize(inputs->size());
+    for (int t = 0; t < numThreads; t++) {
+        if (pthread_create(&threads[t], NULL, ConvertRange, &args[t]) != 0) {
+            std::cout << "ERROR, could not start a conversion thread." << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    running = true;
+}
+
+template <typename T_Input, typename T_Output, typename T_Convert>
+void BatchConverter<T_Input, T_Output, T_Convert>::Wait()
+{
+    if (not running) {
+        return;
+    }
+    for (int t = 0; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    running = false;
+}
+
+template <typename T_Input, typename T_Output, typename T_Convert>
+void *BatchConverter<T_Input, T_Output, T_Convert>::ConvertRange(void *argsP)
+{
+    ThreadArgs *args = static_cast<ThreadArgs *>(argsP);
+    BatchConverter *converter = args->converter;
+    std::vector<T_Input> &inputs = *converter->inputs;
+    std::vector<T_Output> &outputs = *converter->outputs;
+    T_Convert &convert = converter->converts[args->threadIndex];
+    // Records are dealt round robin so that long reads, which tend to
+    // come together, are spread over the threads.
+    for (size_t i = args->threadIndex; i < inputs.size(); i += converter->numThreads) {
+        convert(inputs[i], outputs[i]);
+    }
+    return NULL;
+}
@@ -5,13 +5,18 @@
 #include "BlasrMiscs.hpp"
 
 //------------------MAP READS---------------------------------//
+// When alignedIntervals is given, intervals that overlap one already in
+// it are not aligned again, and the intervals aligned by this call are
+// appended to it.  This lets a second, more sensitive pass over a read
+// only align what the first pass did not find.
 template <typename T_Sequence, typename T_RefSequence, typename T_SuffixArray,
           typename T_TupleCountTable>
 void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_SuffixArray &sarray,
              BWT &bwt, SeqBoundaryFtr<FASTQSequence> &seqBoundary, T_TupleCountTable &ct,
              SequenceIndexDatabase<FASTQSequence> &seqdb, MappingParameters &params,
              MappingMetrics &metrics, std::vector<T_AlignmentCandidate *> &alignmentPtrs,
-             MappingBuffers &mappingBuffers, MappingIPC *mapData, MappingSemaphores &semaphores);
+             MappingBuffers &mappingBuffers, MappingIPC *mapData, MappingSemaphores &semaphores,
+             std::vector<WeightedInterval> *alignedIntervals = NULL);
 
 template <typename T_Sequence>
 void MapRead(T_Sequence &read, T_Sequence &readRC,
@@ -22,6 +27,12 @@ void MapRead(T_Sequence &read, T_Sequence &readRC,
 void MapReads(MappingData<T_SuffixArray, T_GenomeSequence, T_Tuple> *mapData);
 */
 
+// Remove from topIntervals the intervals on the same strand as one in
+// alignedIntervals whose genome and read spans overlap it by at least
+// minOverlap of the longer span.  Returns the number removed.
+int RemoveAlignedIntervals(WeightedIntervalSet &topIntervals,
+                           const std::vector<WeightedInterval> &alignedIntervals, float minOverlap);
+
 //------------------MAKE ALIGNMENTS---------------------------//
 template <typename T_TargetSequence, typename T_QuerySequence, typename TDBSequence>
 void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequence &rcRead,
@@ -29,7 +40,18 @@ void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequ
                     int del, int sdpTupleSize, int useSeqDB,
                     SequenceIndexDatabase<TDBSequence> &seqDB,
                     std::vector<T_AlignmentCandidate *> &alignments, MappingParameters &params,
-                    MappingBuffers &mappingBuffers, int procId = 0);
+                    MappingBuffers &mappingBuffers, int procId = 0, int firstInterval = 0,
+                    int intervalStride = 1);
+
+// Find the top intervals of the anchors on both strands of a read,
+// the forward strand first, into one set of topIntervals.
+template <typename T_Sequence, typename T_PValueFunction>
+void ChainStrands(T_Sequence &read, T_Sequence &readRC, T_GenomeSequence &genome,
+                  SeqBoundaryFtr<FASTQSequence> &seqBoundary, T_PValueFunction &pValueFn,
+                  IntervalSearchParameters &intervalSearchParameters, MappingParameters &params,
+                  MappingBuffers &mappingBuffers, WeightedIntervalSet &topIntervals,
+                  VarianceAccumulator<float> &accumPValue, VarianceAccumulator<float> &accumWeight,
+                  VarianceAccumulator<float> &accumNBases);
 
 template <typename T_RefSequence, typename T_Sequence>
 void PairwiseLocalAlign(T_Sequence &qSeq, T_RefSequence &tSeq, int k, MappingParameters &params,
@@ -9,16 +9,34 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
              BWT &bwt, SeqBoundaryFtr<FASTQSequence> &seqBoundary, T_TupleCountTable &ct,
              SequenceIndexDatabase<FASTQSequence> &seqdb, MappingParameters &params,
              MappingMetrics &metrics, std::vector<T_AlignmentCandidate *> &alignmentPtrs,
-             MappingBuffers &mappingBuffers, MappingIPC *mapData, MappingSemaphores &semaphores)
+             MappingBuffers &mappingBuffers, MappingIPC *mapData, MappingSemaphores &semaphores,
+             std::vector<WeightedInterval> *alignedIntervals)
 {
     bool matchFound;
+    size_t numPreviouslyAligned = (alignedIntervals != NULL) ? alignedIntervals->size() : 0;
     WeightedIntervalSet topIntervals(params.nCandidates);
     int numKeysMatched = 0, rcNumKeysMatched = 0;
     (void)(numKeysMatched);
     (void)(rcNumKeysMatched);
     int expand = params.minExpand;
     metrics.clocks.total.Tick();
+    TelemetryTimer stageTimer(mapData->telemetry);
     int forwardNumBasesMatched = 0, reverseNumBasesMatched = 0;
+
+    //
+    // Map long reads with cores other mapping threads leave idle.  The
+    // helpers seed the reverse strand and align part of the intervals,
+    // each with its own buffers.  Verbose output would interleave, so
+    // it is only done quietly.
+    //
+    int numHelpers = 0;
+    if (mapData->idleCores != NULL and params.verbosity == 0 and
+        read.SubreadLength() >= DNALength(params.intraReadMinLength)) {
+        numHelpers = mapData->idleCores->Acquire(params.intraReadThreads);
+        if (mappingBuffers.helperBuffers.size() < size_t(numHelpers)) {
+            mappingBuffers.helperBuffers.resize(numHelpers);
+        }
+    }
     do {
         matchFound = false;
         mappingBuffers.matchPosList.clear();
@@ -28,9 +46,35 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
         params.anchorParameters.expand = expand;
 
         metrics.clocks.mapToGenome.Tick();
+        stageTimer.Tick();
 
+        //
+        // Seed the reverse strand on a helper while this thread seeds the
+        // forward strand.  The lcp bounds of the first read are written
+        // from both strands, so that read is seeded on this thread.
+        //
+        auto seedReverse = [&](AnchorParameters &anchorParameters) {
+            if (params.useSuffixArray) {
+                rcNumKeysMatched = MapReadToGenome(genome, sarray, readRC, params.lookupTableLength,
+                                                   mappingBuffers.rcMatchPosList, anchorParameters);
+            } else if (params.useBwt) {
+                rcNumKeysMatched = MapReadToGenome(
+                    bwt, readRC, readRC.SubreadStart(), readRC.SubreadEnd(),
+                    mappingBuffers.rcMatchPosList, anchorParameters, reverseNumBasesMatched);
+            }
+        };
         if (params.useSuffixArray) {
             params.anchorParameters.lcpBoundsOutPtr = mapData->lcpBoundsOutPtr;
+        }
+        AnchorParameters rcAnchorParameters = params.anchorParameters;
+        IntraReadTask reverseTask;
+        bool seedReverseOnHelper =
+            (numHelpers > 0 and !params.forwardOnly and rcAnchorParameters.lcpBoundsOutPtr == NULL);
+        if (seedReverseOnHelper) {
+            reverseTask.Start([&]() { seedReverse(rcAnchorParameters); });
+        }
+
+        if (params.useSuffixArray) {
             numKeysMatched = MapReadToGenome(genome, sarray, read, params.lookupTableLength,
                                              mappingBuffers.matchPosList, params.anchorParameters);
 
@@ -39,25 +83,23 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
             // the first read).
             //
             mapData->lcpBoundsOutPtr = NULL;
-            if (!params.forwardOnly) {
-                rcNumKeysMatched =
-                    MapReadToGenome(genome, sarray, readRC, params.lookupTableLength,
-                                    mappingBuffers.rcMatchPosList, params.anchorParameters);
-            }
         } else if (params.useBwt) {
             numKeysMatched = MapReadToGenome(bwt, read, read.SubreadStart(), read.SubreadEnd(),
                                              mappingBuffers.matchPosList, params.anchorParameters,
                                              forwardNumBasesMatched);
-            if (!params.forwardOnly) {
-                rcNumKeysMatched = MapReadToGenome(
-                    bwt, readRC, readRC.SubreadStart(), readRC.SubreadEnd(),
-                    mappingBuffers.rcMatchPosList, params.anchorParameters, reverseNumBasesMatched);
-            }
+        }
+        if (seedReverseOnHelper) {
+            reverseTask.Join();
+        } else if (!params.forwardOnly) {
+            seedReverse(params.anchorParameters);
         }
 
         //
         // Look to see if only the anchors are printed.
-        if (params.anchorFileName != "") {
+        if (mapData->anchorDump != NULL) {
+            mapData->anchorDump->AppendAnchors(read.title, 0, mappingBuffers.matchPosList);
+            mapData->anchorDump->AppendAnchors(readRC.title, 1, mappingBuffers.rcMatchPosList);
+        } else if (params.anchorFileName != "") {
             size_t i;
             if (params.nProc > 1) {
 #ifdef __APPLE__
@@ -87,10 +129,12 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
         metrics.totalAnchors +=
             mappingBuffers.matchPosList.size() + mappingBuffers.rcMatchPosList.size();
         metrics.clocks.mapToGenome.Tock();
+        stageTimer.Tock(SeedingStage);
 
+        stageTimer.Tick();
         metrics.clocks.sortMatchPosList.Tick();
-        SortMatchPosList(mappingBuffers.matchPosList);
-        SortMatchPosList(mappingBuffers.rcMatchPosList);
+        RadixSortMatchPosList(mappingBuffers.matchPosList, mappingBuffers.matchPosSortBuffers);
+        RadixSortMatchPosList(mappingBuffers.rcMatchPosList, mappingBuffers.matchPosSortBuffers);
         metrics.clocks.sortMatchPosList.Tock();
 
         PValueWeightor lisPValue(read, genome, ct.tm, &ct);
@@ -99,8 +143,6 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
         LISSumOfLogPWeightor<T_GenomeSequence, std::vector<ChainedMatchPos> > lisPValueByLogSum(
             genome);
 
-        LISSizeWeightor<std::vector<ChainedMatchPos> > lisWeightFn;
-
         IntervalSearchParameters intervalSearchParameters;
         intervalSearchParameters.globalChainType = params.globalChainType;
         intervalSearchParameters.advanceHalf = params.advanceHalf;
@@ -171,67 +213,19 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
                FindBand(mappingBuffers.matchPosList,
                refCopy, read, 100);
                */
-            FindMaxIncreasingInterval(
-                Forward, mappingBuffers.matchPosList,
-                // allow for indels to stretch out the mapping of the read.
-                (DNALength)((read.SubreadLength()) * (1 + params.indelRate)), params.nCandidates,
-                seqBoundary,
-                lisPValue,  //lisPValue2,
-                lisWeightFn, topIntervals, genome, read, intervalSearchParameters,
-                &mappingBuffers.globalChainEndpointBuffer, mappingBuffers.clusterList, accumPValue,
-                accumWeight, accumNBases);
-            // Uncomment when the version of the weight functor needs the sequence.
-
-            mappingBuffers.clusterList.ResetCoordinates();
-
-            FindMaxIncreasingInterval(
-                Reverse, mappingBuffers.rcMatchPosList,
-                (DNALength)((read.SubreadLength()) * (1 + params.indelRate)), params.nCandidates,
-                seqBoundary,
-                lisPValue,  //lisPValue2
-                lisWeightFn, topIntervals, genome, readRC, intervalSearchParameters,
-                &mappingBuffers.globalChainEndpointBuffer, mappingBuffers.revStrandClusterList,
-                accumPValue, accumWeight, accumNBases);
+            ChainStrands(read, readRC, genome, seqBoundary, lisPValue, intervalSearchParameters,
+                         params, mappingBuffers, topIntervals, accumPValue, accumWeight,
+                         accumNBases);
         } else if (params.pValueType == 1) {
-            FindMaxIncreasingInterval(
-                Forward, mappingBuffers.matchPosList,
-                // allow for indels to stretch out the mapping of the read.
-                (DNALength)((read.SubreadLength()) * (1 + params.indelRate)), params.nCandidates,
-                seqBoundary,
-                lisPValueByWeight,  // different from pvaltype == 2 and 0
-                lisWeightFn, topIntervals, genome, read, intervalSearchParameters,
-                &mappingBuffers.globalChainEndpointBuffer, mappingBuffers.clusterList, accumPValue,
-                accumWeight, accumNBases);
-
-            mappingBuffers.clusterList.ResetCoordinates();
-            FindMaxIncreasingInterval(
-                Reverse, mappingBuffers.rcMatchPosList,
-                (DNALength)((read.SubreadLength()) * (1 + params.indelRate)), params.nCandidates,
-                seqBoundary,
-                lisPValueByWeight,  // different from pvaltype == 2 and 0
-                lisWeightFn, topIntervals, genome, readRC, intervalSearchParameters,
-                &mappingBuffers.globalChainEndpointBuffer, mappingBuffers.revStrandClusterList,
-                accumPValue, accumWeight, accumNBases);
+            // different from pvaltype == 2 and 0
+            ChainStrands(read, readRC, genome, seqBoundary, lisPValueByWeight,
+                         intervalSearchParameters, params, mappingBuffers, topIntervals,
+                         accumPValue, accumWeight, accumNBases);
         } else if (params.pValueType == 2) {
-            FindMaxIncreasingInterval(
-                Forward, mappingBuffers.matchPosList,
-                // allow for indels to stretch out the mapping of the read.
-                (DNALength)((read.SubreadLength()) * (1 + params.indelRate)), params.nCandidates,
-                seqBoundary,
-                lisPValueByLogSum,  // different from pvaltype == 1 and 0
-                lisWeightFn, topIntervals, genome, read, intervalSearchParameters,
-                &mappingBuffers.globalChainEndpointBuffer, mappingBuffers.clusterList, accumPValue,
-                accumWeight, accumNBases);
-
-            mappingBuffers.clusterList.ResetCoordinates();
-            FindMaxIncreasingInterval(
-                Reverse, mappingBuffers.rcMatchPosList,
-                (DNALength)((read.SubreadLength()) * (1 + params.indelRate)), params.nCandidates,
-                seqBoundary,
-                lisPValueByLogSum,  // different from pvaltype == 1 and 0
-                lisWeightFn, topIntervals, genome, readRC, intervalSearchParameters,
-                &mappingBuffers.globalChainEndpointBuffer, mappingBuffers.revStrandClusterList,
-                accumPValue, accumWeight, accumNBases);
+            // different from pvaltype == 1 and 0
+            ChainStrands(read, readRC, genome, seqBoundary, lisPValueByLogSum,
+                         intervalSearchParameters, params, mappingBuffers, topIntervals,
+                         accumPValue, accumWeight, accumNBases);
         }
 
         mappingBuffers.clusterList.numBases.insert(
@@ -245,6 +239,23 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
             mappingBuffers.revStrandClusterList.numAnchors.end());
 
         metrics.clocks.findMaxIncreasingInterval.Tock();
+        stageTimer.Tock(ChainingStage);
+
+        //
+        // Skip intervals an earlier pass has aligned, and remember the
+        // ones aligned by this expansion (replacing the previous one,
+        // whose alignments are deleted).
+        //
+        if (alignedIntervals != NULL) {
+            alignedIntervals->erase(alignedIntervals->begin() + numPreviouslyAligned,
+                                    alignedIntervals->end());
+            std::vector<WeightedInterval> earlierIntervals(
+                alignedIntervals->begin(), alignedIntervals->begin() + numPreviouslyAligned);
+            RemoveAlignedIntervals(topIntervals, earlierIntervals,
+                                   params.minFractionToBeConsideredOverlapping);
+            alignedIntervals->insert(alignedIntervals->end(), topIntervals.begin(),
+                                     topIntervals.end());
+        }
 
         //
         // Print verbose output.
@@ -277,9 +288,33 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
             alignmentPtrs[i] = new T_AlignmentCandidate;
         }
         metrics.clocks.alignIntervals.Tick();
-        AlignIntervals(genome, read, readRC, topIntervals, SMRTDistanceMatrix, params.indel,
-                       params.indel, params.sdpTupleSize, params.useSeqDB, seqdb, alignmentPtrs,
-                       params, mappingBuffers, params.startRead);
+        stageTimer.Tick();
+        int numAlignTasks = std::min(numHelpers, int(topIntervals.size()) - 1);
+        if (numAlignTasks > 0) {
+            //
+            // Every (numAlignTasks+1)'th interval is aligned by the same
+            // thread, into the alignment it would get sequentially.
+            //
+            std::vector<IntraReadTask> alignTasks(numAlignTasks);
+            for (int t = 0; t < numAlignTasks; t++) {
+                alignTasks[t].Start([&, t]() {
+                    AlignIntervals(genome, read, readRC, topIntervals, SMRTDistanceMatrix,
+                                   params.indel, params.indel, params.sdpTupleSize, params.useSeqDB,
+                                   seqdb, alignmentPtrs, params, mappingBuffers.helperBuffers[t],
+                                   params.startRead, t + 1, numAlignTasks + 1);
+                });
+            }
+            AlignIntervals(genome, read, readRC, topIntervals, SMRTDistanceMatrix, params.indel,
+                           params.indel, params.sdpTupleSize, params.useSeqDB, seqdb, alignmentPtrs,
+                           params, mappingBuffers, params.startRead, 0, numAlignTasks + 1);
+            for (int t = 0; t < numAlignTasks; t++) {
+                alignTasks[t].Join();
+            }
+        } else {
+            AlignIntervals(genome, read, readRC, topIntervals, SMRTDistanceMatrix, params.indel,
+                           params.indel, params.sdpTupleSize, params.useSeqDB, seqdb, alignmentPtrs,
+                           params, mappingBuffers, params.startRead);
+        }
 
         /*    std::cout << read.title << std::endl;
               for (i = 0; i < alignmentPtrs.size(); i++) {
@@ -290,6 +325,7 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
 
         std::sort(alignmentPtrs.begin(), alignmentPtrs.end(), SortAlignmentPointersByScore());
         metrics.clocks.alignIntervals.Tock();
+        stageTimer.Tock(SDPStage);
 
         //
         // Evalutate the matches that are found for 'good enough'.
@@ -320,6 +356,9 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
         }
         ++expand;
     } while (expand <= params.maxExpand and matchFound == false);
+    if (numHelpers > 0) {
+        mapData->idleCores->Release(numHelpers);
+    }
     metrics.clocks.total.Tock();
     UInt i;
     int totalCells = 0;
@@ -361,9 +400,11 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
     // of an alignment and the alignment score.
     //
     if (params.refineAlignments) {
+        stageTimer.Tick();
         RefineAlignments(bothQueryStrands, genome, alignmentPtrs, params, mappingBuffers);
         RemoveLowQualityAlignments(read, alignmentPtrs, params);
         RemoveOverlappingAlignments(alignmentPtrs, params);
+        stageTimer.Tock(RefinementStage);
     }
 
     //
@@ -460,8 +501,14 @@ void MapRead(T_Sequence &read, T_Sequence &readRC, T_RefSequence &genome, T_Suff
         for (i = 0; i < alignmentPtrs.size(); i++) {
             alignmentPtrs[i]->numSignificantClusters = numSignificantClusters;
         }
-        if (mapData->clusterFilePtr != NULL and topIntervals.size() > 0 and
-            alignmentPtrs.size() > 0) {
+        if (mapData->clusterDump != NULL and topIntervals.size() > 0 and alignmentPtrs.size() > 0) {
+            WeightedIntervalSet::iterator intvIt = topIntervals.begin();
+            mapData->clusterDump->AppendCluster(
+                (*intvIt).size, (*intvIt).pValue, (*intvIt).nAnchors, read.length,
+                alignmentPtrs[0]->score, alignmentPtrs[0]->pctSimilarity, minExpAnchors,
+                alignmentPtrs[0]->qAlignedSeq.length);
+        } else if (mapData->clusterFilePtr != NULL and topIntervals.size() > 0 and
+                   alignmentPtrs.size() > 0) {
             WeightedIntervalSet::iterator intvIt = topIntervals.begin();
             if (params.nProc > 1) {
 #ifdef __APPLE__
@@ -546,13 +593,79 @@ void MapRead(T_Sequence &read, T_Sequence &readRC,
                    semaphores);
 }
 
+// Fraction of the longer of [aStart, aEnd) and [bStart, bEnd) that
+// the two share.
+float IntervalOverlapFraction(int aStart, int aEnd, int bStart, int bEnd)
+{
+    int longest = std::max(aEnd - aStart, bEnd - bStart);
+    int ovp = std::min(aEnd, bEnd) - std::max(aStart, bStart);
+    if (longest <= 0 or ovp <= 0) {
+        return 0;
+    }
+    return float(ovp) / longest;
+}
+
+int RemoveAlignedIntervals(WeightedIntervalSet &topIntervals,
+                           const std::vector<WeightedInterval> &alignedIntervals, float minOverlap)
+{
+    int numRemoved = 0;
+    WeightedIntervalSet::iterator intvIt = topIntervals.begin();
+    while (intvIt != topIntervals.end()) {
+        bool isAligned = false;
+        for (size_t a = 0; a < alignedIntervals.size() and not isAligned; a++) {
+            const WeightedInterval &aligned = alignedIntervals[a];
+            isAligned = ((*intvIt).GetStrandIndex() == aligned.GetStrandIndex() and
+                         IntervalOverlapFraction((*intvIt).start, (*intvIt).end, aligned.start,
+                                                 aligned.end) >= minOverlap and
+                         IntervalOverlapFraction((*intvIt).qStart, (*intvIt).qEnd, aligned.qStart,
+                                                 aligned.qEnd) >= minOverlap);
+        }
+        if (isAligned) {
+            topIntervals.erase(intvIt++);
+            numRemoved++;
+        } else {
+            ++intvIt;
+        }
+    }
+    return numRemoved;
+}
+
+template <typename T_Sequence, typename T_PValueFunction>
+void ChainStrands(T_Sequence &read, T_Sequence &readRC, T_GenomeSequence &genome,
+                  SeqBoundaryFtr<FASTQSequence> &seqBoundary, T_PValueFunction &pValueFn,
+                  IntervalSearchParameters &intervalSearchParameters, MappingParameters &params,
+                  MappingBuffers &mappingBuffers, WeightedIntervalSet &topIntervals,
+                  VarianceAccumulator<float> &accumPValue, VarianceAccumulator<float> &accumWeight,
+                  VarianceAccumulator<float> &accumNBases)
+{
+    LISSizeWeightor<std::vector<ChainedMatchPos> > lisWeightFn;
+    // allow for indels to stretch out the mapping of the read.
+    DNALength maxIntervalLength = (DNALength)((read.SubreadLength()) * (1 + params.indelRate));
+
+    FindMaxIncreasingInterval(Forward, mappingBuffers.matchPosList, maxIntervalLength,
+                              params.nCandidates, seqBoundary, pValueFn, lisWeightFn, topIntervals,
+                              genome, read, intervalSearchParameters,
+                              &mappingBuffers.globalChainEndpointBuffer, mappingBuffers.clusterList,
+                              accumPValue, accumWeight, accumNBases);
+    // Uncomment when the version of the weight functor needs the sequence.
+
+    mappingBuffers.clusterList.ResetCoordinates();
+
+    FindMaxIncreasingInterval(
+        Reverse, mappingBuffers.rcMatchPosList, maxIntervalLength, params.nCandidates, seqBoundary,
+        pValueFn, lisWeightFn, topIntervals, genome, readRC, intervalSearchParameters,
+        &mappingBuffers.globalChainEndpointBuffer, mappingBuffers.revStrandClusterList, accumPValue,
+        accumWeight, accumNBases);
+}
+
 template <typename T_TargetSequence, typename T_QuerySequence, typename TDBSequence>
 void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequence &rcRead,
                     WeightedIntervalSet &weightedIntervals, int mutationCostMatrix[][5], int ins,
                     int del, int sdpTupleSize, int useSeqDB,
                     SequenceIndexDatabase<TDBSequence> &seqDB,
                     std::vector<T_AlignmentCandidate *> &alignments, MappingParameters &params,
-                    MappingBuffers &mappingBuffers, int procId)
+                    MappingBuffers &mappingBuffers, int procId, int firstInterval,
+                    int intervalStride)
 {
     (void)(mutationCostMatrix);
     (void)(ins);
@@ -574,6 +687,8 @@ void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequ
         SMRTDistanceMatrix, params.insertion, params.deletion);
     DistanceMatrixScoreFunction<DNASequence, FASTQSequence> distScoreFn2(SMRTDistanceMatrix, ins,
                                                                          ins);
+    UniformDistanceScoreFunction<DNASequence, FASTQSequence> uniformScoreFn(distScoreFn,
+                                                                            SMRTDistanceMatrix);
 
     //
     // Assume there is at least one interval.
@@ -584,6 +699,12 @@ void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequ
     int alignmentIndex = 0;
 
     do {
+        if (alignmentIndex % intervalStride != firstInterval) {
+            // Aligned by another thread.
+            ++alignmentIndex;
+            ++intvIt;
+            continue;
+        }
 
         T_AlignmentCandidate *alignment = alignments[alignmentIndex];
         alignment->clusterWeight = (*intvIt).size;  // totalAnchorSize == size
@@ -915,18 +1036,25 @@ void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequ
                         if (params.separateGaps == true and qSubSeq.length > 0 and
                             tSubSeq.length > 0 and
                             ((1.0 * qSubSeq.length) / tSubSeq.length < 0.25)) {
-                            OneGapAlign(qSubSeq, tSubSeq, distScoreFn, mappingBuffers,
-                                        alignmentInGap);
+                            DispatchDistanceScoreFunction(
+                                uniformScoreFn, distScoreFn, [&](auto &scoreFn) {
+                                    return OneGapAlign(qSubSeq, tSubSeq, scoreFn, mappingBuffers,
+                                                       alignmentInGap);
+                                });
                         } else {
                             /*
                                This is the 'normal/default' way to align between
                                gaps.  It is more well tested than OneGapAlign.
                                */
-                            SDPAlign(qSubSeq, tSubSeq, distScoreFn, params.sdpTupleSize,
-                                     params.sdpIns, params.sdpDel, params.indelRate * 2,
-                                     alignmentInGap, mappingBuffers, Global,
-                                     params.detailedSDPAlignment, params.extendFrontAlignment,
-                                     params.recurseOver, params.fastSDP);
+                            DispatchDistanceScoreFunction(
+                                uniformScoreFn, distScoreFn, [&](auto &scoreFn) {
+                                    return SDPAlign(
+                                        qSubSeq, tSubSeq, scoreFn, params.sdpTupleSize,
+                                        params.sdpIns, params.sdpDel, params.indelRate * 2,
+                                        alignmentInGap, mappingBuffers, Global,
+                                        params.detailedSDPAlignment, params.extendFrontAlignment,
+                                        params.recurseOver, params.fastSDP);
+                                });
                         }
 
                         //
@@ -991,8 +1119,6 @@ void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequ
                 }
                 anchorsOnly.tPos = alignment->tPos;
                 anchorsOnly.qPos = alignment->qPos;
-                ComputeAlignmentStats(*alignment, alignment->qAlignedSeq.seq,
-                                      alignment->tAlignedSeq.seq, distScoreFn);
 
                 tAlignedSeq.Free();
                 qAlignedSeq.Free();
@@ -1000,10 +1126,20 @@ void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequ
                 qSubSeq.Free();
             } else {
                 alignScore =
-                    SDPAlign(alignment->qAlignedSeq, alignment->tAlignedSeq, distScoreFn,
-                             sdpTupleSize, params.sdpIns, params.sdpDel, params.indelRate * 3,
-                             *alignment, mappingBuffers, Local, params.detailedSDPAlignment,
-                             params.extendFrontAlignment, params.recurseOver, params.fastSDP);
+                    DispatchDistanceScoreFunction(uniformScoreFn, distScoreFn, [&](auto &scoreFn) {
+                        return SDPAlign(alignment->qAlignedSeq, alignment->tAlignedSeq, scoreFn,
+                                        sdpTupleSize, params.sdpIns, params.sdpDel,
+                                        params.indelRate * 3, *alignment, mappingBuffers, Local,
+                                        params.detailedSDPAlignment, params.extendFrontAlignment,
+                                        params.recurseOver, params.fastSDP);
+                    });
+            }
+            //
+            // The stats are computed once the alignment of the interval
+            // is final, below.  Only the extension messages show them
+            // before that.
+            //
+            if (params.verbosity > 0) {
                 ComputeAlignmentStats(*alignment, alignment->qAlignedSeq.seq,
                                       alignment->tAlignedSeq.seq, distScoreFn);
             }
@@ -1031,209 +1167,121 @@ void AlignIntervals(T_TargetSequence &genome, T_QuerySequence &read, T_QuerySequ
             assert(not params.placeGapConsistently);
 
             //
-            // Modify the alignment so that the start and end of the
-            // alignment strings are at the alignment boundaries.
-            //
-            // Since the query sequence is pointing at a subsequence of the
-            // read (and is always in the forward direction), just reference
-            // a new portion of the read.
-            alignment->qAlignedSeqPos = alignment->qAlignedSeqPos + alignment->qPos;
-            alignment->qAlignedSeqLength = alignment->QEnd();
-            alignment->qAlignedSeq.ReferenceSubstring(read, alignment->qAlignedSeqPos,
-                                                      alignment->qAlignedSeqLength);
-            alignment->qPos = 0;
-
+            // Extend both ends of the alignment over the read and the
+            // strand of the contig it maps to, reading the bases of both
+            // in place.  The query always is the forward read here, since
+            // gaps are not placed consistently.  Extensions stop when
+            // they stop improving (-maxExtendDropoff rows) or reach the
+            // end of the read or contig.
             //
-            // Since the target sequence may be on the forward or reverse
-            // strand, a copy of the subsequence is made, and the original
-            // sequence free'd.
-            //
-            DNASequence tSubseq;
-            alignment->tAlignedSeqPos = alignment->tAlignedSeqPos + alignment->tPos;
-            alignment->tAlignedSeqLength = alignment->TEnd();
-            tSubseq.Copy(alignment->tAlignedSeq, alignment->tPos, alignment->tAlignedSeqLength);
-            alignment->tPos = 0;
-
-            alignment->tAlignedSeq.Free();
-            alignment->tAlignedSeq.TakeOwnership(tSubseq);
-
-            DNALength maximumExtendLength = 500;
-
             if (alignment->blocks.size() > 0) {
-                int lastAlignedBlock = alignment->blocks.size() - 1;
-                DNALength lastAlignedQPos = alignment->blocks[lastAlignedBlock].QEnd() +
-                                            alignment->qPos + alignment->qAlignedSeqPos;
-                DNALength lastAlignedTPos = alignment->blocks[lastAlignedBlock].TEnd() +
-                                            alignment->tPos + alignment->tAlignedSeqPos;
-                T_AlignmentCandidate extendedAlignmentForward, extendedAlignmentReverse;
-                int forwardScore, reverseScore;
-
-                SMRTSequence readSuffix;
-                DNALength readSuffixLength;
-                DNASequence genomeSuffix;
-                DNALength genomeSuffixLength;
-
-                SMRTSequence readPrefix;
-                DNALength readPrefixLength;
-                DNASequence genomePrefix;
-                DNALength genomePrefixLength;
-
-                //
-                // Align the entire end of the read if it is short enough.
-                //
-                readSuffixLength = std::min(read.length - lastAlignedQPos, maximumExtendLength);
-                if (readSuffixLength > 0) {
-                    readSuffix.ReferenceSubstring(read, lastAlignedQPos, readSuffixLength);
-                } else {
-                    readSuffix.length = 0;
-                }
+                std::vector<Block> &blocks = alignment->blocks;
+                std::vector<Block> &extendedBlocks = mappingBuffers.extensionBuffers.blocks;
+                GenomeStrandView strand(genome.seq, genome.length, alignment->tStrand == Reverse);
+                DNALength qOrigin = alignment->qAlignedSeqPos + alignment->qPos;
+                DNALength tOrigin = alignment->tAlignedSeqPos + alignment->tPos;
+                DNALength firstAlignedQPos = qOrigin + blocks[0].qPos;
+                DNALength firstAlignedTPos = tOrigin + blocks[0].tPos;
+                DNALength lastAlignedQPos = qOrigin + blocks.back().QEnd();
+                DNALength lastAlignedTPos = tOrigin + blocks.back().TEnd();
+                DNALength readPrefixLength, genomePrefixLength;
+                DNALength readSuffixLength, genomeSuffixLength;
 
                 //
-                // Align The entire end of the genome up to the maximum extend length;
+                // Bases are scored as in the rest of the alignment, with the
+                // uniform score function when the matrix allows it.
                 //
-                genomeSuffixLength =
-                    std::min(intervalContigEndPos - lastAlignedTPos, maximumExtendLength);
-                if (genomeSuffixLength > 0) {
-                    if (alignment->tStrand == Forward) {
-                        genomeSuffix.Copy(genome, lastAlignedTPos, genomeSuffixLength);
-                    } else {
-                        static_cast<DNASequence *>(&genome)->CopyAsRC(genomeSuffix, lastAlignedTPos,
-                                                                      genomeSuffixLength);
-                    }
-                } else {
-                    genomeSuffix.length = 0;
-                }
-                forwardScore = 0;
-                if (readSuffix.length > 0 and genomeSuffix.length > 0) {
-                    forwardScore = ExtendAlignmentForward(
-                        readSuffix, 0, genomeSuffix, 0, params.extendBandSize,
-                        // Reuse buffers to speed up alignment
-                        mappingBuffers.scoreMat, mappingBuffers.pathMat,
-                        // Do the alignment in the forward direction.
-                        extendedAlignmentForward, distScoreFn,
-                        1,  // don't bother attempting
-                        // to extend the alignment
-                        // if one of the sequences
-                        // is less than 1 base long
-                        params.maxExtendDropoff);
+                DistanceMatrixScoreFunction<GenomeStrandView, FASTQSequence> extendDistScoreFn(
+                    SMRTDistanceMatrix, params.insertion, params.deletion);
+                UniformDistanceScoreFunction<GenomeStrandView, FASTQSequence> extendUniformScoreFn(
+                    extendDistScoreFn, SMRTDistanceMatrix);
+
+                extendedBlocks.clear();
+                int reverseScore = DispatchDistanceScoreFunction(
+                    extendUniformScoreFn, extendDistScoreFn, [&](auto &scoreFn) {
+                        return ExtendAlignmentInPlace(
+                            read, firstAlignedQPos, firstAlignedQPos, strand, firstAlignedTPos,
+                            (firstAlignedTPos > intervalContigStartPos)
+                                ? firstAlignedTPos - intervalContigStartPos
+                                : 0,
+                            -1, params.extendBandSize, scoreFn, params.maxExtendDropoff,
+                            mappingBuffers.extensionBuffers, extendedBlocks, readPrefixLength,
+                            genomePrefixLength);
+                    });
+                for (size_t b = 0; b < blocks.size(); b++) {
+                    extendedBlocks.push_back(blocks[b]);
+                    extendedBlocks.back().qPos += qOrigin;
+                    extendedBlocks.back().tPos += tOrigin;
                 }
-
-                if (forwardScore < 0) {
-                    //
-                    // The extended alignment considers the whole genome, but
-                    // should be modified to be starting at the end of where
-                    // the original alignment left off.
-                    //
-                    if (params.verbosity > 0) {
+                int forwardScore = DispatchDistanceScoreFunction(
+                    extendUniformScoreFn, extendDistScoreFn, [&](auto &scoreFn) {
+                        return ExtendAlignmentInPlace(
+                            read, lastAlignedQPos, read.length - lastAlignedQPos, strand,
+                            lastAlignedTPos, (intervalContigEndPos > lastAlignedTPos)
+                                                 ? intervalContigEndPos - lastAlignedTPos
+                                                 : 0,
+                            1, params.extendBandSize, scoreFn, params.maxExtendDropoff,
+                            mappingBuffers.extensionBuffers, extendedBlocks, readSuffixLength,
+                            genomeSuffixLength);
+                    });
+
+                if (params.verbosity > 0) {
+                    if (forwardScore < 0) {
                         std::cout << "forward extended an alignment of score " << alignment->score
-                                  << " with score " << forwardScore << " by "
-                                  << extendedAlignmentForward.blocks.size() << " blocks and length "
-                                  << extendedAlignmentForward
-                                         .blocks[extendedAlignmentForward.blocks.size() - 1]
-                                         .qPos
+                                  << " with score " << forwardScore << " by " << readSuffixLength
+                                  << " read and " << genomeSuffixLength << " genome bases"
                                   << std::endl;
                     }
-                    extendedAlignmentForward.tAlignedSeqPos = lastAlignedTPos;
-
-                    extendedAlignmentForward.qAlignedSeqPos = lastAlignedQPos;
-
-                    genomeSuffix.length =
-                        extendedAlignmentForward.tPos + extendedAlignmentForward.TEnd();
-                    alignment->tAlignedSeq.Append(genomeSuffix);
-                    alignment->qAlignedSeq.length +=
-                        extendedAlignmentForward.qPos + extendedAlignmentForward.QEnd();
-                    assert(alignment->qAlignedSeq.length <= read.length);
-                    alignment->AppendAlignment(extendedAlignmentForward);
-                }
-
-                DNALength firstAlignedQPos = alignment->qPos + alignment->qAlignedSeqPos;
-                DNALength firstAlignedTPos = alignment->tPos + alignment->tAlignedSeqPos;
-
-                readPrefixLength = std::min(firstAlignedQPos, maximumExtendLength);
-                if (readPrefixLength > 0) {
-                    readPrefix.ReferenceSubstring(read, firstAlignedQPos - readPrefixLength,
-                                                  readPrefixLength);
-                } else {
-                    readPrefix.length = 0;
-                }
-
-                genomePrefixLength =
-                    std::min(firstAlignedTPos - intervalContigStartPos, maximumExtendLength);
-                if (genomePrefixLength > 0) {
-                    if (alignment->tStrand == 0) {
-                        genomePrefix.Copy(genome, firstAlignedTPos - genomePrefixLength,
-                                          genomePrefixLength);
-                    } else {
-                        static_cast<DNASequence *>(&genome)->MakeRC(
-                            genomePrefix, firstAlignedTPos - genomePrefixLength,
-                            genomePrefixLength);
-                    }
-                }
-                reverseScore = 0;
-                if (readPrefix.length > 0 and genomePrefix.length > 0) {
-                    reverseScore = ExtendAlignmentReverse(
-                        readPrefix, readPrefix.length - 1, genomePrefix, genomePrefixLength - 1,
-                        params.extendBandSize,  //k
-                        mappingBuffers.scoreMat, mappingBuffers.pathMat, extendedAlignmentReverse,
-                        distScoreFn,
-                        1,  // don't bother attempting
-                        // to extend the alignment
-                        // if one of the sequences
-                        // is less than 1 base long
-                        params.maxExtendDropoff);
-                }
-
-                if (reverseScore < 0) {
-                    //
-                    // Make alignment->tPos relative to the beginning of the
-                    // extended alignment so that when it is appended, the
-                    // coordinates match correctly.
-                    if (params.verbosity > 0) {
+                    if (reverseScore < 0) {
                         std::cout << "reverse extended an alignment of score " << alignment->score
-                                  << " with score " << reverseScore << " by "
-                                  << extendedAlignmentReverse.blocks.size() << " blocks and length "
-                                  << extendedAlignmentReverse
-                                         .blocks[extendedAlignmentReverse.blocks.size() - 1]
-                                         .qPos
+                                  << " with score " << reverseScore << " by " << readPrefixLength
+                                  << " read and " << genomePrefixLength << " genome bases"
                                   << std::endl;
                     }
-                    extendedAlignmentReverse.tAlignedSeqPos = firstAlignedTPos - genomePrefixLength;
-                    extendedAlignmentReverse.qAlignedSeqPos = firstAlignedQPos - readPrefixLength;
-                    extendedAlignmentReverse.AppendAlignment(*alignment);
-
-                    genomePrefix.Append(alignment->tAlignedSeq,
-                                        genomePrefix.length - alignment->tPos);
-                    alignment->tAlignedSeq.Free();
-                    alignment->tAlignedSeq.TakeOwnership(genomePrefix);
-
-                    alignment->blocks = extendedAlignmentReverse.blocks;
-
-                    alignment->tAlignedSeqPos = extendedAlignmentReverse.tAlignedSeqPos;
-                    alignment->tPos = extendedAlignmentReverse.tPos;
+                }
 
-                    alignment->qAlignedSeqPos = extendedAlignmentReverse.qAlignedSeqPos;
-                    alignment->qAlignedSeq.length =
-                        readPrefix.length + alignment->qAlignedSeq.length;
-                    alignment->qPos = extendedAlignmentReverse.qPos;
-                    alignment->qAlignedSeq.seq = readPrefix.seq;
-                    //
-                    // Make sure the two ways of accounting for aligned sequence
-                    // length are in sync.  This needs to go.
-                    //
-                    if (alignment->blocks.size() > 0) {
-                        alignment->qAlignedSeqLength = alignment->qAlignedSeq.length;
-                        alignment->tAlignedSeqLength = alignment->tAlignedSeq.length;
+                //
+                // Rebase the blocks on the start of the extended alignment,
+                // joining blocks that meet on the same diagonal.
+                //
+                DNALength qStart = firstAlignedQPos - readPrefixLength;
+                DNALength tStart = firstAlignedTPos - genomePrefixLength;
+                blocks.clear();
+                for (size_t b = 0; b < extendedBlocks.size(); b++) {
+                    Block block = extendedBlocks[b];
+                    block.qPos -= qStart;
+                    block.tPos -= tStart;
+                    if (blocks.size() > 0 and blocks.back().QEnd() == block.qPos and
+                        blocks.back().TEnd() == block.tPos) {
+                        blocks.back().length += block.length;
                     } else {
-                        alignment->qAlignedSeqLength = alignment->qAlignedSeq.length = 0;
-                        alignment->tAlignedSeqLength = alignment->tAlignedSeq.length = 0;
+                        blocks.push_back(block);
                     }
-                }  // end of if (reverseScore < 0 )
-                readSuffix.Free();
-                readPrefix.Free();
-                genomePrefix.Free();
-                genomeSuffix.Free();
+                }
+
+                //
+                // Point the aligned sequences at the extended alignment.  On
+                // the forward strand the target references the genome; the
+                // reverse strand is copied once, as it is not stored.
+                //
+                alignment->qAlignedSeqPos = qStart;
+                alignment->qAlignedSeqLength = blocks.back().QEnd();
+                alignment->qAlignedSeq.ReferenceSubstring(read, alignment->qAlignedSeqPos,
+                                                          alignment->qAlignedSeqLength);
+                alignment->qPos = 0;
+
+                alignment->tAlignedSeqPos = tStart;
+                alignment->tAlignedSeqLength = blocks.back().TEnd();
+                alignment->tAlignedSeq.Free();
+                if (alignment->tStrand == Forward) {
+                    alignment->tAlignedSeq.ReferenceSubstring(genome, alignment->tAlignedSeqPos,
+                                                              alignment->tAlignedSeqLength);
+                } else {
+                    genome.CopyAsRC(alignment->tAlignedSeq, alignment->tAlignedSeqPos,
+                                    alignment->tAlignedSeqLength);
+                }
+                alignment->tPos = 0;
             }
-            tSubseq.Free();
         }
 
         if (params.verbosity > 0) {
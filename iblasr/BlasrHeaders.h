@@ -95,10 +95,19 @@
 #include <pbdata/utils/SMRTTitle.hpp>
 #include <pbdata/utils/TimeUtils.hpp>
 
+#include "DebugDump.hpp"
+#include "ExtendAlignmentInPlace.hpp"
+#include "IntervalIndex.hpp"
+#include "IntraReadParallel.hpp"
 #include "MappingBuffers.hpp"
 #include "MappingIPC.h"
 #include "MappingSemaphores.h"
+#include "MappingTelemetry.hpp"
+#include "RadixSortMatchPos.hpp"
 #include "ReadAlignments.hpp"
+#include "ReadPrefetcher.hpp"
+#include "RegionTableStream.hpp"
+#include "UniformScoreFunction.hpp"
 
 typedef SMRTSequence T_Sequence;
 typedef FASTASequence T_GenomeSequence;
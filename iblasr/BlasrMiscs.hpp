@@ -4,15 +4,35 @@
 #include "BlasrHeaders.h"
 
 //-------------------------Fetch Reads----------------------------//
+// When regionTableStream is given, also fetch the regions of the zmw
+// of the read into zmwRegionTable while holding the reader semaphore,
+// so that the stream is advanced in the same order as the reads.
+// The time spent waiting on the semaphore is recorded in telemetry.
 template <typename T_Sequence>
 bool GetNextReadThroughSemaphore(ReaderAgglomerate &reader, MappingParameters &params,
                                  T_Sequence &read, std::string &readGroupId, int &associatedRandInt,
-                                 MappingSemaphores &semaphores);
+                                 MappingSemaphores &semaphores,
+                                 RegionTableStream *regionTableStream = NULL,
+                                 RegionTable *zmwRegionTable = NULL,
+                                 ThreadTelemetry *telemetry = NULL);
+
+// Fetch the regions of the zmw a read (or the subreads of a zmw)
+// came from.
+void GetZmwRegions(SMRTSequence &read, RegionTableStream &regionTableStream,
+                   RegionTable &zmwRegionTable);
+
+void GetZmwRegions(std::vector<SMRTSequence> &reads, RegionTableStream &regionTableStream,
+                   RegionTable &zmwRegionTable);
 
 //---------------------MAKE & CHECK READS-------------------------//
 //FIXME: move to SMRTSequence
 bool ReadHasMeaningfulQualityValues(FASTQSequence &sequence);
 
+// Free quality tracks of a read that neither scoring nor output
+// will use (see MappingParameters::DetermineRequiredQVs), so that
+// they are not copied into every subread and reverse complement.
+void DropUnusedQualityValues(SMRTSequence &read, const MappingParameters &params);
+
 //FIXME: Move to SMRTSequence
 // Given a SMRT sequence and a subread interval, make the subread.
 // Input:
@@ -38,6 +58,29 @@ void MakeSubreadOfInterval(SMRTSequence &subreadSequence, SMRTSequence &smrtRead
 void MakeSubreadRC(SMRTSequence &subreadSequenceRC, SMRTSequence &subreadSequence,
                    SMRTSequence &smrtRead);
 
+// Make the subread of an interval and its reverse complement without
+// copying smrtRead.  The views are equivalent to the output of
+// MakeSubreadOfInterval and MakeSubreadRC, but reference the quality
+// values of smrtRead and smrtReadRC, and take their bases from masks in
+// mappingBuffers, so they only cost the length of the interval.
+// Input:
+//   smrtRead        - a SMRT read
+//   smrtReadRC      - reverse complement of smrtRead
+//   subreadInterval - a subread interval
+//   params          - mapping parameters
+// Output:
+//   subreadView     - the subread, valid until ClearSubreadViews
+//   subreadViewRC   - the reverse complement of the subread
+void MakeSubreadViews(SMRTSequence &subreadView, SMRTSequence &subreadViewRC,
+                      SMRTSequence &smrtRead, SMRTSequence &smrtReadRC,
+                      ReadInterval &subreadInterval, MappingParameters &params,
+                      MappingBuffers &mappingBuffers);
+
+// Mask the bases of views made by MakeSubreadViews again and release
+// the views.
+void ClearSubreadViews(SMRTSequence &subreadView, SMRTSequence &subreadViewRC,
+                       MappingBuffers &mappingBuffers);
+
 // Construct subreads invervals from subreads
 void MakeSubreadIntervals(std::vector<SMRTSequence> &subreads,
                           std::vector<ReadInterval> &subreadIntervals);
@@ -6,15 +6,20 @@
 template <typename T_Sequence>
 bool GetNextReadThroughSemaphore(ReaderAgglomerate &reader, MappingParameters &params,
                                  T_Sequence &read, std::string &readGroupId, int &associatedRandInt,
-                                 MappingSemaphores &semaphores)
+                                 MappingSemaphores &semaphores,
+                                 RegionTableStream *regionTableStream, RegionTable *zmwRegionTable,
+                                 ThreadTelemetry *telemetry)
 {
     // Wait on a semaphore
     if (params.nProc > 1) {
+        TelemetryTimer waitTimer(telemetry);
+        waitTimer.Tick();
 #ifdef __APPLE__
         sem_wait(semaphores.reader);
 #else
         sem_wait(&semaphores.reader);
 #endif
+        waitTimer.Tock(ReaderWaitStage);
     }
 
     bool returnValue = true;
@@ -32,6 +37,11 @@ bool GetNextReadThroughSemaphore(ReaderAgglomerate &reader, MappingParameters &p
     // sending this alignment out to printing.
     readGroupId = reader.readGroupId;
 
+    if (returnValue and regionTableStream != NULL) {
+        assert(zmwRegionTable != NULL);
+        GetZmwRegions(read, *regionTableStream, *zmwRegionTable);
+    }
+
     if (params.nProc > 1) {
 #ifdef __APPLE__
         sem_post(semaphores.reader);
@@ -42,6 +52,22 @@ bool GetNextReadThroughSemaphore(ReaderAgglomerate &reader, MappingParameters &p
     return returnValue;
 }
 
+void GetZmwRegions(SMRTSequence &read, RegionTableStream &regionTableStream,
+                   RegionTable &zmwRegionTable)
+{
+    regionTableStream.GetZmwRegions(read.HoleNumber(), zmwRegionTable);
+}
+
+void GetZmwRegions(std::vector<SMRTSequence> &reads, RegionTableStream &regionTableStream,
+                   RegionTable &zmwRegionTable)
+{
+    if (reads.empty()) {
+        zmwRegionTable.Reset();
+    } else {
+        regionTableStream.GetZmwRegions(reads[0].HoleNumber(), zmwRegionTable);
+    }
+}
+
 bool ReadHasMeaningfulQualityValues(FASTQSequence &sequence)
 {
     if (sequence.qual.Empty() == true) {
@@ -69,6 +95,31 @@ bool ReadHasMeaningfulQualityValues(FASTQSequence &sequence)
     }
 }
 
+void DropUnusedQualityValues(SMRTSequence &read, const MappingParameters &params)
+{
+    // Only free tracks this read owns.
+    if (read.deleteOnExit == false) {
+        return;
+    }
+    if (not params.needReadQuality) {
+        read.qual.Free();
+    }
+    if (not params.needReadQVs) {
+        read.insertionQV.Free();
+        read.deletionQV.Free();
+        read.substitutionQV.Free();
+        read.mergeQV.Free();
+        if (read.deletionTag != NULL) {
+            delete[] read.deletionTag;
+            read.deletionTag = NULL;
+        }
+        if (read.substitutionTag != NULL) {
+            delete[] read.substitutionTag;
+            read.substitutionTag = NULL;
+        }
+    }
+}
+
 // Given a SMRT sequence and a subread interval, make the subread.
 // Input:
 //   smrtRead         - a SMRT sequence
@@ -117,6 +168,64 @@ void MakeSubreadRC(SMRTSequence &subreadSequenceRC, SMRTSequence &subreadSequenc
     subreadSequenceRC.zmwData = smrtRead.zmwData;
 }
 
+void MakeSubreadViews(SMRTSequence &subreadView, SMRTSequence &subreadViewRC,
+                      SMRTSequence &smrtRead, SMRTSequence &smrtReadRC,
+                      ReadInterval &subreadInterval, MappingParameters &params,
+                      MappingBuffers &mappingBuffers)
+{
+    DNALength length = smrtRead.length;
+    DNALength start = subreadInterval.start;
+    DNALength end = subreadInterval.end;
+    assert(smrtReadRC.length == length and start <= end and end <= length);
+
+    //
+    // The masks are all 'N' between views, so growing or shrinking them
+    // to the length of this read keeps them masked, and only the
+    // subread itself has to be copied in.
+    //
+    std::vector<Nucleotide> &mask = mappingBuffers.subreadMask;
+    std::vector<Nucleotide> &maskRC = mappingBuffers.subreadMaskRC;
+    mask.resize(std::max(length, DNALength(1)), 'N');
+    maskRC.resize(std::max(length, DNALength(1)), 'N');
+    std::copy(&smrtRead.seq[start], &smrtRead.seq[end], &mask[start]);
+    std::copy(&smrtReadRC.seq[length - end], &smrtReadRC.seq[length - start],
+              &maskRC[length - end]);
+
+    subreadView.Free();
+    subreadView.ReferenceSubstring(smrtRead, 0, length);
+    subreadView.seq = &mask[0];
+    subreadView.SubreadStart(start);
+    subreadView.SubreadEnd(end);
+    if (!params.preserveReadTitle) {
+        smrtRead.SetSubreadTitle(subreadView, start, end);
+    } else {
+        subreadView.CopyTitle(smrtRead.title);
+    }
+    subreadView.zmwData = smrtRead.zmwData;
+
+    subreadViewRC.Free();
+    subreadViewRC.ReferenceSubstring(smrtReadRC, 0, length);
+    subreadViewRC.seq = &maskRC[0];
+    subreadViewRC.SubreadStart(length - end);
+    subreadViewRC.SubreadEnd(length - start);
+    subreadViewRC.CopyTitle(subreadView.GetTitle());
+    subreadViewRC.zmwData = smrtRead.zmwData;
+}
+
+void ClearSubreadViews(SMRTSequence &subreadView, SMRTSequence &subreadViewRC,
+                       MappingBuffers &mappingBuffers)
+{
+    DNALength length = subreadView.length;
+    DNALength start = subreadView.SubreadStart();
+    DNALength end = subreadView.SubreadEnd();
+    std::fill(&mappingBuffers.subreadMask[start], &mappingBuffers.subreadMask[end], 'N');
+    std::fill(&mappingBuffers.subreadMaskRC[length - end],
+              &mappingBuffers.subreadMaskRC[length - start], 'N');
+    // The views own their titles only.
+    subreadView.Free();
+    subreadViewRC.Free();
+}
+
 int CountZero(unsigned char *ptr, int length)
 {
     int i;
@@ -68,6 +68,12 @@ int RemoveLowQualityAlignments(T_Sequence &read, std::vector<T_AlignmentCandidat
 int RemoveOverlappingAlignments(std::vector<T_AlignmentCandidate *> &alignmentPtrs,
                                 MappingParameters &params);
 
+// FIXME: move to class ReadAlignments
+// Delete the alignments that are not in selectedAlignmentPtrs, e.g.
+// those not selected for printing.  alignmentPtrs is not resized.
+void DeleteUnselectedAlignments(std::vector<T_AlignmentCandidate *> &alignmentPtrs,
+                                const std::vector<T_AlignmentCandidate *> &selectedAlignmentPtrs);
+
 // FIXME: move to class ReadAlignments
 // Delete all alignments from index startIndex in vector, inclusive.
 void DeleteAlignments(std::vector<T_AlignmentCandidate *> &alignmentPtrs, int startIndex = 0);
@@ -107,7 +113,7 @@ void PrintAlignments(std::vector<T_AlignmentCandidate *> alignmentPtrs, SMRTSequ
 #ifdef USE_PBBAM
                      SMRTSequence &subread, PacBio::BAM::IRecordWriter *bamWriterPtr,
 #endif
-                     MappingSemaphores &semaphores);
+                     MappingSemaphores &semaphores, ThreadTelemetry *telemetry = NULL);
 
 void PrintAlignmentPtrs(std::vector<T_AlignmentCandidate *> &alignmentPtrs,
                         std::ostream &out = std::cout);
@@ -133,6 +139,6 @@ void PrintAllReadAlignments(ReadAlignments &allReadAlignments, AlignmentContext
 #ifdef USE_PBBAM
                             PacBio::BAM::IRecordWriter *bamWriterPtr,
 #endif
-                            MappingSemaphores &semaphores);
+                            MappingSemaphores &semaphores, ThreadTelemetry *telemetry = NULL);
 
 #include "BlasrUtilsImpl.hpp"
@@ -397,30 +397,78 @@ void PartitionOverlappingAlignments(std::vector<T_AlignmentCandidate *> &alignme
         return;
     }
 
-    std::set<int>::iterator setIt, setEnd;
+    //
+    // Alignment i joins the first partition holding an alignment that
+    // overlaps it on the read or that it contains.  Either only happens
+    // when the read intervals intersect, forward strand intervals for
+    // the first and strand intervals for the second, so only the
+    // alignments found by an interval index are compared to i.
+    //
+    int nAlignments = alignmentPtrs.size();
+    std::vector<long> forwardStarts(nAlignments), forwardEnds(nAlignments);
+    std::vector<long> strandStarts(nAlignments), strandEnds(nAlignments);
     int i, p;
-    bool overlapFound = false;
-    for (i = 0; i < int(alignmentPtrs.size()); i++) {
-        overlapFound = false;
-        for (p = 0; p < int(partitions.size()) and overlapFound == false; p++) {
-            setEnd = partitions[p].end();
-            for (setIt = partitions[p].begin();
-                 setIt != partitions[p].end() and overlapFound == false; ++setIt) {
-                if (AlignmentsOverlap(*alignmentPtrs[i], *alignmentPtrs[*setIt], minOverlap) or
-                    ((alignmentPtrs[i]->QAlignStart() <= alignmentPtrs[*setIt]->QAlignStart()) and
-                     (alignmentPtrs[i]->QAlignEnd() > alignmentPtrs[*setIt]->QAlignEnd()))) {
-                    partitions[p].insert(i);
-                    overlapFound = true;
-                }
+    for (i = 0; i < nAlignments; i++) {
+        int alnStart, alnEnd;
+        bool useForwardStrand = true;
+        alignmentPtrs[i]->GetQInterval(alnStart, alnEnd, useForwardStrand);
+        forwardStarts[i] = alnStart;
+        forwardEnds[i] = alnEnd;
+        strandStarts[i] = alignmentPtrs[i]->QAlignStart();
+        strandEnds[i] = alignmentPtrs[i]->QAlignEnd();
+    }
+    IntervalIndex forwardIndex, strandIndex;
+    forwardIndex.Initialize(forwardStarts, forwardEnds);
+    strandIndex.Initialize(strandStarts, strandEnds);
+
+    std::vector<int> partitionOf(nAlignments, -1);
+    for (p = 0; p < int(partitions.size()); p++) {
+        std::set<int>::iterator setIt;
+        for (setIt = partitions[p].begin(); setIt != partitions[p].end(); ++setIt) {
+            if (partitionOf[*setIt] == -1) {
+                partitionOf[*setIt] = p;
+                forwardIndex.Activate(*setIt);
+                strandIndex.Activate(*setIt);
+            }
+        }
+    }
+
+    std::vector<int> candidates;
+    for (i = 0; i < nAlignments; i++) {
+        candidates.clear();
+        if (minOverlap < 0) {
+            // Any two alignments overlap by more than a negative fraction.
+            forwardIndex.FindIntersecting(std::numeric_limits<long>::min(),
+                                          std::numeric_limits<long>::max(), candidates);
+        } else {
+            forwardIndex.FindIntersecting(forwardStarts[i], forwardEnds[i], candidates);
+        }
+        strandIndex.FindIntersecting(strandStarts[i], strandEnds[i], candidates);
+
+        int firstPartition = -1;
+        for (size_t c = 0; c < candidates.size(); c++) {
+            int s = candidates[c];
+            if (firstPartition != -1 and partitionOf[s] >= firstPartition) {
+                continue;
+            }
+            if (AlignmentsOverlap(*alignmentPtrs[i], *alignmentPtrs[s], minOverlap) or
+                (strandStarts[i] <= strandStarts[s] and strandEnds[i] > strandEnds[s])) {
+                firstPartition = partitionOf[s];
             }
         }
         //
         // If this alignment does not overlap any other, create a
         // partition with it as the first element.
         //
-        if (overlapFound == false) {
+        if (firstPartition == -1) {
+            firstPartition = partitions.size();
             partitions.push_back(std::set<int>());
-            partitions[partitions.size() - 1].insert(i);
+        }
+        partitions[firstPartition].insert(i);
+        if (partitionOf[i] == -1) {
+            partitionOf[i] = firstPartition;
+            forwardIndex.Activate(i);
+            strandIndex.Activate(i);
         }
     }
 }
@@ -509,24 +557,39 @@ int RemoveOverlappingAlignments(std::vector<T_AlignmentCandidate *> &alignmentPt
     alignmentIsContained.resize(alignmentPtrs.size());
     std::fill(alignmentIsContained.begin(), alignmentIsContained.end(), false);
 
-    int j;
     int numContained = 0;
     int curNotContained = 0;
 
     if (alignmentPtrs.size() > 0) {
+        //
+        // An alignment can only contain, or be contained in, one whose
+        // genomic interval intersects it.  Index the alignments that may
+        // still be removed, i.e. those after i that are not contained.
+        //
+        std::vector<long> tBegins(alignmentPtrs.size()), tEnds(alignmentPtrs.size());
         UInt i;
+        for (i = 0; i < alignmentPtrs.size(); i++) {
+            tBegins[i] = alignmentPtrs[i]->GenomicTBegin();
+            tEnds[i] = alignmentPtrs[i]->GenomicTEnd();
+        }
+        IntervalIndex removableIndex;
+        removableIndex.Initialize(tBegins, tEnds);
+        for (i = 0; i < alignmentPtrs.size(); i++) {
+            removableIndex.Activate(i);
+        }
+
+        std::vector<int> overlapping;
         for (i = 0; i < alignmentPtrs.size() - 1; i++) {
+            removableIndex.Deactivate(i);
             T_AlignmentCandidate *aref = alignmentPtrs[i];
             if (aref->pctSimilarity < params.minPctSimilarity) {
                 continue;
             }
-            for (j = i + 1; j < int(alignmentPtrs.size()); j++) {
-                //
-                // Make sure this alignment isn't already removed.
-                //
-                if (alignmentIsContained[j]) {
-                    continue;
-                }
+            overlapping.clear();
+            removableIndex.FindIntersecting(tBegins[i], tEnds[i], overlapping);
+            std::sort(overlapping.begin(), overlapping.end());
+            for (size_t o = 0; o < overlapping.size(); o++) {
+                int j = overlapping[o];
 
                 //
                 // Only check for containment if the two sequences are from the same contig.
@@ -538,14 +601,13 @@ int RemoveOverlappingAlignments(std::vector<T_AlignmentCandidate *> &alignmentPt
                 //
                 // Check for an alignment that is fully overlapping another
                 // alignment.
-                if (aref->GenomicTBegin() <= alignmentPtrs[j]->GenomicTBegin() and
-                    aref->GenomicTEnd() >= alignmentPtrs[j]->GenomicTEnd() and
-                    alignmentPtrs[i]->tIndex == alignmentPtrs[j]->tIndex) {
+                if (tBegins[i] <= tBegins[j] and tEnds[i] >= tEnds[j]) {
                     //
                     // Alignment i is contained in j is only true if it has a worse score.
                     //
                     if (aref->score <= alignmentPtrs[j]->score) {
                         alignmentIsContained[j] = true;
+                        removableIndex.Deactivate(j);
                     }
                     if (params.verbosity >= 2) {
                         std::cout << "alignment " << i << " is contained in " << j << std::endl;
@@ -555,9 +617,7 @@ int RemoveOverlappingAlignments(std::vector<T_AlignmentCandidate *> &alignmentPt
                                          alignmentPtrs[j]->tAlignedSeqLength
                                   << std::endl;
                     }
-                } else if (alignmentPtrs[j]->GenomicTBegin() <= aref->GenomicTBegin() and
-                           alignmentPtrs[j]->GenomicTEnd() >= aref->GenomicTEnd() and
-                           alignmentPtrs[i]->tIndex == alignmentPtrs[j]->tIndex) {
+                } else if (tBegins[j] <= tBegins[i] and tEnds[j] >= tEnds[i]) {
                     if (params.verbosity >= 2) {
                         std::cout << "ALIGNMENT " << j << " is contained in " << i << std::endl;
                         std::cout << alignmentPtrs[j]->tAlignedSeqPos << " " << aref->tAlignedSeqPos
@@ -589,6 +649,18 @@ int RemoveOverlappingAlignments(std::vector<T_AlignmentCandidate *> &alignmentPt
     return alignmentPtrs.size();
 }
 
+void DeleteUnselectedAlignments(std::vector<T_AlignmentCandidate *> &alignmentPtrs,
+                                const std::vector<T_AlignmentCandidate *> &selectedAlignmentPtrs)
+{
+    std::vector<T_AlignmentCandidate *> selected(selectedAlignmentPtrs);
+    std::sort(selected.begin(), selected.end());
+    for (size_t i = 0; i < alignmentPtrs.size(); i++) {
+        if (not std::binary_search(selected.begin(), selected.end(), alignmentPtrs[i])) {
+            delete alignmentPtrs[i];
+        }
+    }
+}
+
 // Delete all alignments from index startIndex in vector, inclusive.
 void DeleteAlignments(std::vector<T_AlignmentCandidate *> &alignmentPtrs, int startIndex)
 {
@@ -610,6 +682,8 @@ void RefineAlignment(std::vector<T_Sequence *> &bothQueryStrands, T_RefSequence
     DNASequence tSeq;
     DistanceMatrixScoreFunction<DNASequence, FASTQSequence> distScoreFn(
         SMRTDistanceMatrix, params.deletion, params.insertion);
+    UniformDistanceScoreFunction<DNASequence, FASTQSequence> uniformScoreFn(distScoreFn,
+                                                                            SMRTDistanceMatrix);
 
     DistanceMatrixScoreFunction<DNASequence, FASTQSequence> distScoreFn2(
         SMRTDistanceMatrix, params.indel, params.indel);
@@ -648,6 +722,7 @@ void RefineAlignment(std::vector<T_Sequence *> &bothQueryStrands, T_RefSequence
         alignmentCandidate.gaps = refinedAlignment.gaps;
         alignmentCandidate.tPos = refinedAlignment.tPos;
         alignmentCandidate.qPos = refinedAlignment.qPos + bothQueryStrands[0]->SubreadStart();
+        alignmentCandidate.CopyStats(refinedAlignment);
         alignmentCandidate.score = refinedAlignment.score;
         subread.Free();
     } else if (params.useGuidedAlign) {
@@ -691,14 +766,16 @@ void RefineAlignment(std::vector<T_Sequence *> &bothQueryStrands, T_RefSequence
                                 Global, false);
                 }
             } else {
-                if (params.affineAlign) {
-                    AffineGuidedAlign(qSeq, tSeq, alignmentCandidate, distScoreFn, params.bandSize,
-                                      mappingBuffers, refinedAlignment, Global, false);
-                } else {
-                    GuidedAlign(qSeq, tSeq, alignmentCandidate, distScoreFn,
-                                params.guidedAlignBandSize, mappingBuffers, refinedAlignment,
-                                Global, false);
-                }
+                DispatchDistanceScoreFunction(uniformScoreFn, distScoreFn, [&](auto &scoreFn) {
+                    if (params.affineAlign) {
+                        AffineGuidedAlign(qSeq, tSeq, alignmentCandidate, scoreFn, params.bandSize,
+                                          mappingBuffers, refinedAlignment, Global, false);
+                    } else {
+                        GuidedAlign(qSeq, tSeq, alignmentCandidate, scoreFn,
+                                    params.guidedAlignBandSize, mappingBuffers, refinedAlignment,
+                                    Global, false);
+                    }
+                });
             }
             ComputeAlignmentStats(refinedAlignment, qSeq.seq, tSeq.seq, distScoreFn2,
                                   params.affineAlign);
@@ -988,14 +1065,25 @@ void PrintAlignments(std::vector<T_AlignmentCandidate *> alignmentPtrs, SMRTSequ
 #ifdef USE_PBBAM
                      SMRTSequence &subread, PacBio::BAM::IRecordWriter *bamWriterPtr,
 #endif
-                     MappingSemaphores &semaphores)
+                     MappingSemaphores &semaphores, ThreadTelemetry *telemetry)
 {
     if (params.nProc > 1) {
+        TelemetryTimer waitTimer(telemetry);
+        waitTimer.Tick();
 #ifdef __APPLE__
         sem_wait(semaphores.writer);
 #else
         sem_wait(&semaphores.writer);
 #endif
+        waitTimer.Tock(WriterWaitStage);
+    }
+    //
+    // Text output is measured by the stream position; it is -1 when
+    // writing to stdout, or to a bam file through bamWriterPtr.
+    //
+    std::streampos outStart = -1;
+    if (telemetry != NULL) {
+        outStart = outFile.tellp();
     }
     for (int i = 0; i < int(alignmentPtrs.size()); i++) {
         T_AlignmentCandidate *aref = alignmentPtrs[i];
@@ -1042,6 +1130,13 @@ void PrintAlignments(std::vector<T_AlignmentCandidate *> alignmentPtrs, SMRTSequ
                        );
     }
 
+    if (telemetry != NULL and outStart != std::streampos(-1)) {
+        std::streampos outEnd = outFile.tellp();
+        if (outEnd != std::streampos(-1)) {
+            telemetry->RecordBytesWritten(outEnd - outStart);
+        }
+    }
+
     if (params.nProc > 1) {
 #ifdef __APPLE__
         sem_post(semaphores.writer);
@@ -1095,7 +1190,7 @@ void PrintAllReadAlignments(ReadAlignments &allReadAlignments, AlignmentContext
 #ifdef USE_PBBAM
                             PacBio::BAM::IRecordWriter *bamWriterPtr,
 #endif
-                            MappingSemaphores &semaphores)
+                            MappingSemaphores &semaphores, ThreadTelemetry *telemetry)
 {
     int subreadIndex;
     int nAlignedSubreads = allReadAlignments.GetNAlignedSeq();
@@ -1146,7 +1241,7 @@ void PrintAllReadAlignments(ReadAlignments &allReadAlignments, AlignmentContext
 #ifdef USE_PBBAM
                             *sourceSubread, bamWriterPtr,
 #endif
-                            semaphores);
+                            semaphores, telemetry);
         } else {
             //
             // Print the unaligned sequences.
@@ -0,0 +1,458 @@
+#pragma once
+
+#include <pbdata/Types.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+//
+// Sorts the suffixes of a text one bucket at a time, where a bucket
+// holds the suffixes that start with the same PrefixLength() characters,
+// so that callers can build a suffix array, or anything derived from
+// one, from any number of passes over the text.
+//
+// Suffixes are sorted by multikey quicksort on their characters.
+// Suffixes that share more than CoverSize() characters are ordered by the
+// ranks of a difference cover sample of the suffixes instead, as in the
+// lightweight construction of Karkkainen and Burkhardt.  No comparison
+// reads more than CoverSize() characters, which keeps long repeats from
+// being compared base by base.  The only memory used besides the text
+// and the output is the table of prefix counts and one rank per sample
+// suffix.  Both are sized to fit the workspace given to Initialize.
+//
+// Characters are ordered by their values, and a suffix that is a prefix
+// of another comes first, as with the other suffix array builders.
+//
+template <typename T_Char>
+class BucketSuffixSorter
+{
+public:
+    BucketSuffixSorter();
+
+    // Count the prefixes of text and rank the sample suffixes, using
+    // no more than maxWorkspace bytes, including what SortSuffixes
+    // needs.  Returns false if even the sparsest sample does not fit.
+    bool Initialize(const T_Char *textP, DNALength lengthP, size_t maxWorkspace);
+
+    int PrefixLength() const { return prefixLength; }
+
+    int CoverSize() const { return coverSize; }
+
+    UInt NumPrefixCodes() const { return prefixCounts.size(); }
+
+    // The number of suffixes in the bucket of code.  Codes are in suffix
+    // order.
+    DNALength PrefixCount(UInt code) const { return prefixCounts[code]; }
+
+    //
+    // Store the suffixes in the buckets of firstCode up to but not
+    // including endCode in sorted, in suffix order.  sorted must have
+    // room for the suffixes of those buckets.
+    //
+    template <typename T_Index>
+    void SortSuffixes(UInt firstCode, UInt endCode, T_Index *sorted) const;
+
+private:
+    const T_Char *text;
+    DNALength length;
+    UInt alphabetSize;
+    int prefixLength;
+    std::vector<DNALength> prefixCounts;
+    // Codes of the suffixes shorter than the prefix length, whose
+    // codes are padded with the smallest character.
+    std::vector<UInt> shortSuffixCodes;
+
+    int coverSize;
+    std::vector<int> cover;
+    // The index in cover of each residue, or -1.
+    std::vector<int> coverIndex;
+    // A residue a in the cover such that a + d is also in it, for each d.
+    std::vector<int> coverPair;
+    std::vector<DNALength> sampleRanks;
+
+    // Character depth of suffix pos, or -1 past the end of the text.
+    int CharAt(DNALength pos, DNALength depth) const;
+
+    UInt PrefixCode(DNALength pos) const;
+
+    DNALength NumSamples() const;
+
+    DNALength SampleIndex(DNALength pos) const;
+
+    DNALength SamplePos(DNALength sampleIndex) const;
+
+    // Order two suffixes that share their first coverSize characters.
+    bool SampleLess(DNALength a, DNALength b) const;
+
+    void InitializeCover(int v);
+
+    void RankSamples();
+
+    //
+    // Multikey quicksort of the suffixes from begin to end, which share
+    // their first depth characters, on characters up to maxDepth.
+    // onGroup(groupBegin, groupEnd) is called for every run of suffixes
+    // that are equal up to maxDepth, including single suffixes.
+    //
+    template <typename T_Index, typename T_OnGroup>
+    void SortByChars(T_Index *begin, T_Index *end, DNALength depth, DNALength maxDepth,
+                     T_OnGroup onGroup) const;
+};
+
+template <typename T_Char>
+BucketSuffixSorter<T_Char>::BucketSuffixSorter()
+    : text(NULL), length(0), alphabetSize(1), prefixLength(1), coverSize(0)
+{
+}
+
+template <typename T_Char>
+bool BucketSuffixSorter<T_Char>::Initialize(const T_Char *textP, DNALength lengthP,
+                                            size_t maxWorkspace)
+{
+    text = textP;
+    length = lengthP;
+
+    alphabetSize = 1;
+    for (DNALength p = 0; p < length; p++) {
+        alphabetSize = std::max(alphabetSize, UInt(text[p]) + 1);
+    }
+
+    //
+    // Use the longest prefix whose counts, and the bucket offsets of
+    // SortSuffixes, take an eighth of the workspace at most.  Longer
+    // prefixes than there are suffixes only leave buckets empty.
+    //
+    size_t maxCodes = std::min<size_t>(maxWorkspace / 8 / (3 * sizeof(DNALength)), length);
+    UInt numCodes = alphabetSize;
+    prefixLength = 1;
+    while (prefixLength < 12 and size_t(numCodes) * alphabetSize <= maxCodes) {
+        numCodes *= alphabetSize;
+        prefixLength++;
+    }
+    size_t codeBytes = 3 * size_t(numCodes) * sizeof(DNALength);
+
+    //
+    // Use the densest sample that fits, since a denser sample breaks
+    // ties within fewer characters.  Ranking the sample takes two words
+    // and a bit per sample.
+    //
+    static const int coverSizes[] = {64, 256, 1024, 4096, 16384};
+    coverSize = 0;
+    for (int v : coverSizes) {
+        InitializeCover(v);
+        size_t numSamples = size_t(length / v + 1) * cover.size();
+        size_t sampleBytes = numSamples * (2 * sizeof(DNALength)) + numSamples / 8;
+        if (codeBytes + sampleBytes <= maxWorkspace) {
+            coverSize = v;
+            break;
+        }
+    }
+    if (coverSize == 0) {
+        return false;
+    }
+
+    prefixCounts.assign(numCodes, 0);
+    shortSuffixCodes.clear();
+    for (DNALength p = 0; p < length; p++) {
+        UInt code = PrefixCode(p);
+        prefixCounts[code]++;
+        if (length - p < DNALength(prefixLength)) {
+            shortSuffixCodes.push_back(code);
+        }
+    }
+
+    RankSamples();
+    return true;
+}
+
+template <typename T_Char>
+template <typename T_Index>
+void BucketSuffixSorter<T_Char>::SortSuffixes(UInt firstCode, UInt endCode, T_Index *sorted) const
+{
+    //
+    // Place the suffixes of each bucket, then sort the buckets one by one.
+    //
+    std::vector<DNALength> bucketStarts(endCode - firstCode + 1, 0);
+    for (UInt code = firstCode; code < endCode; code++) {
+        bucketStarts[code - firstCode + 1] = bucketStarts[code - firstCode] + prefixCounts[code];
+    }
+    std::vector<DNALength> next(bucketStarts.begin(), bucketStarts.end() - 1);
+
+    UInt highPlace = 1;
+    for (int i = 1; i < prefixLength; i++) {
+        highPlace *= alphabetSize;
+    }
+    UInt code = (length > 0) ? PrefixCode(0) : 0;
+    for (DNALength p = 0; p < length; p++) {
+        if (code >= firstCode and code < endCode) {
+            sorted[next[code - firstCode]++] = p;
+        }
+        // Roll the code over to the suffix at p + 1.
+        code = (code - CharAt(p, 0) * highPlace) * alphabetSize;
+        if (p + prefixLength < length) {
+            code += text[p + prefixLength];
+        }
+    }
+
+    auto sortBySamples = [this](T_Index *groupBegin, T_Index *groupEnd) {
+        if (groupEnd - groupBegin > 1) {
+            std::sort(groupBegin, groupEnd,
+                      [this](T_Index a, T_Index b) { return SampleLess(a, b); });
+        }
+    };
+    for (UInt c = firstCode; c < endCode; c++) {
+        T_Index *bucketBegin = sorted + bucketStarts[c - firstCode];
+        T_Index *bucketEnd = sorted + bucketStarts[c - firstCode + 1];
+        bool hasShortSuffix = std::find(shortSuffixCodes.begin(), shortSuffixCodes.end(), c) !=
+                              shortSuffixCodes.end();
+        DNALength startDepth = hasShortSuffix ? 0 : prefixLength;
+        SortByChars(bucketBegin, bucketEnd, startDepth, coverSize, sortBySamples);
+    }
+}
+
+template <typename T_Char>
+inline int BucketSuffixSorter<T_Char>::CharAt(DNALength pos, DNALength depth) const
+{
+    if (pos + depth < length) {
+        return text[pos + depth];
+    }
+    return -1;
+}
+
+template <typename T_Char>
+UInt BucketSuffixSorter<T_Char>::PrefixCode(DNALength pos) const
+{
+    UInt code = 0;
+    for (int i = 0; i < prefixLength; i++) {
+        code = code * alphabetSize + std::max(CharAt(pos, i), 0);
+    }
+    return code;
+}
+
+template <typename T_Char>
+DNALength BucketSuffixSorter<T_Char>::NumSamples() const
+{
+    DNALength numSamples = (length / coverSize) * cover.size();
+    for (int a : cover) {
+        if (DNALength(a) < length % coverSize) {
+            numSamples++;
+        }
+    }
+    return numSamples;
+}
+
+template <typename T_Char>
+inline DNALength BucketSuffixSorter<T_Char>::SampleIndex(DNALength pos) const
+{
+    assert(coverIndex[pos % coverSize] >= 0);
+    return (pos / coverSize) * cover.size() + coverIndex[pos % coverSize];
+}
+
+template <typename T_Char>
+inline DNALength BucketSuffixSorter<T_Char>::SamplePos(DNALength sampleIndex) const
+{
+    return (sampleIndex / cover.size()) * coverSize + cover[sampleIndex % cover.size()];
+}
+
+template <typename T_Char>
+inline bool BucketSuffixSorter<T_Char>::SampleLess(DNALength a, DNALength b) const
+{
+    //
+    // Both suffixes are longer than coverSize, and some offset h below
+    // coverSize lands both on samples.  The suffixes agree before h, so
+    // they are ordered as the samples are.
+    //
+    int d = (int(b % coverSize) - int(a % coverSize) + coverSize) % coverSize;
+    DNALength h = (coverPair[d] - int(a % coverSize) + coverSize) % coverSize;
+    return sampleRanks[SampleIndex(a + h)] < sampleRanks[SampleIndex(b + h)];
+}
+
+template <typename T_Char>
+void BucketSuffixSorter<T_Char>::InitializeCover(int v)
+{
+    //
+    // The residues below r and the multiples of r, with r the ceiling
+    // of sqrt(v), cover v: any d is j * r - b for some j and b < r.
+    //
+    int r = int(std::ceil(std::sqrt(double(v))));
+    coverIndex.assign(v, -1);
+    for (int a = 0; a < r; a++) {
+        coverIndex[a] = 0;
+    }
+    for (int j = 1; j * r < v + r; j++) {
+        coverIndex[(j * r) % v] = 0;
+    }
+    cover.clear();
+    for (int a = 0; a < v; a++) {
+        if (coverIndex[a] == 0) {
+            coverIndex[a] = cover.size();
+            cover.push_back(a);
+        }
+    }
+    coverPair.assign(v, -1);
+    for (int d = 0; d < v; d++) {
+        for (int a : cover) {
+            if (coverIndex[(a + d) % v] >= 0) {
+                coverPair[d] = a;
+                break;
+            }
+        }
+        assert(coverPair[d] >= 0);
+    }
+}
+
+template <typename T_Char>
+void BucketSuffixSorter<T_Char>::RankSamples()
+{
+    DNALength numSamples = NumSamples();
+    std::vector<DNALength> sorted(numSamples);
+    for (DNALength s = 0; s < numSamples; s++) {
+        sorted[s] = SamplePos(s);
+    }
+
+    //
+    // Sort the samples on their first coverSize characters.  A sample's
+    // rank is the index of the first sample of its group.
+    //
+    sampleRanks.assign(numSamples, 0);
+    std::vector<bool> groupStarts(numSamples + 1, false);
+    groupStarts[numSamples] = true;
+    DNALength *sortedBegin = sorted.data();
+    SortByChars(sortedBegin, sortedBegin + numSamples, 0, coverSize,
+                [&](DNALength *groupBegin, DNALength *groupEnd) {
+                    DNALength groupStart = groupBegin - sortedBegin;
+                    groupStarts[groupStart] = true;
+                    for (DNALength *s = groupBegin; s < groupEnd; s++) {
+                        sampleRanks[SampleIndex(*s)] = groupStart;
+                    }
+                });
+    for (DNALength s = 0; s < numSamples; s++) {
+        sorted[s] = SampleIndex(sorted[s]);
+    }
+
+    //
+    // Then refine the groups by prefix doubling: the sample coverSize
+    // characters on is the next one of the same residue, so after
+    // sorting on h groups of coverSize characters, a group is sorted
+    // on 2h by the ranks of the samples h * cover.size() further on.
+    //
+    DNALength step = cover.size();
+    bool unsorted = true;
+    while (unsorted) {
+        unsorted = false;
+        auto key = [&](DNALength s) -> DNALength {
+            return (s + step < numSamples) ? sampleRanks[s + step] + 1 : 0;
+        };
+        DNALength groupStart = 0;
+        while (groupStart < numSamples) {
+            DNALength groupEnd = groupStart + 1;
+            while (not groupStarts[groupEnd]) {
+                groupEnd++;
+            }
+            if (groupEnd - groupStart > 1) {
+                std::sort(sorted.begin() + groupStart, sorted.begin() + groupEnd,
+                          [&](DNALength a, DNALength b) { return key(a) < key(b); });
+                // Split the group before updating its ranks, since keys
+                // may refer to samples in this group.
+                for (DNALength i = groupStart + 1; i < groupEnd; i++) {
+                    if (key(sorted[i]) != key(sorted[i - 1])) {
+                        groupStarts[i] = true;
+                    }
+                }
+                DNALength subgroupStart = groupStart;
+                for (DNALength i = groupStart; i < groupEnd; i++) {
+                    if (groupStarts[i]) {
+                        subgroupStart = i;
+                    }
+                    sampleRanks[sorted[i]] = subgroupStart;
+                    if (i > subgroupStart) {
+                        unsorted = true;
+                    }
+                }
+            }
+            groupStart = groupEnd;
+        }
+        if (step > numSamples) {
+            break;
+        }
+        step *= 2;
+    }
+}
+
+template <typename T_Char>
+template <typename T_Index, typename T_OnGroup>
+void BucketSuffixSorter<T_Char>::SortByChars(T_Index *begin, T_Index *end, DNALength depth,
+                                             DNALength maxDepth, T_OnGroup onGroup) const
+{
+    class Range
+    {
+    public:
+        T_Index *begin, *end;
+        DNALength depth;
+    };
+    std::vector<Range> ranges;
+    ranges.push_back(Range{begin, end, depth});
+    while (not ranges.empty()) {
+        Range range = ranges.back();
+        ranges.pop_back();
+        T_Index *b = range.begin, *e = range.end;
+        DNALength d = range.depth;
+        if (e - b <= 1 or d >= maxDepth) {
+            if (e > b) {
+                onGroup(b, e);
+            }
+            continue;
+        }
+        if (e - b < 16) {
+            //
+            // Sort small ranges directly and report the runs of equal
+            // suffixes.
+            //
+            auto compare = [&](T_Index x, T_Index y) -> int {
+                for (DNALength i = d; i < maxDepth; i++) {
+                    int cx = CharAt(x, i), cy = CharAt(y, i);
+                    if (cx != cy) {
+                        return (cx < cy) ? -1 : 1;
+                    }
+                    if (cx < 0) {
+                        break;
+                    }
+                }
+                return 0;
+            };
+            std::sort(b, e, [&](T_Index x, T_Index y) { return compare(x, y) < 0; });
+            T_Index *groupBegin = b;
+            for (T_Index *s = b + 1; s <= e; s++) {
+                if (s == e or compare(*groupBegin, *s) != 0) {
+                    onGroup(groupBegin, s);
+                    groupBegin = s;
+                }
+            }
+            continue;
+        }
+
+        int c0 = CharAt(b[0], d), c1 = CharAt(b[(e - b) / 2], d), c2 = CharAt(e[-1], d);
+        int pivot = std::max(std::min(c0, c1), std::min(std::max(c0, c1), c2));
+        T_Index *lt = b, *i = b, *gt = e;
+        while (i < gt) {
+            int c = CharAt(*i, d);
+            if (c < pivot) {
+                std::swap(*lt++, *i++);
+            } else if (c > pivot) {
+                std::swap(*i, *--gt);
+            } else {
+                i++;
+            }
+        }
+        ranges.push_back(Range{gt, e, d});
+        if (pivot < 0) {
+            // Only one suffix ends at a given depth.
+            onGroup(lt, gt);
+        } else {
+            ranges.push_back(Range{lt, gt, d + 1});
+        }
+        ranges.push_back(Range{b, lt, d});
+    }
+}
@@ -0,0 +1,416 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//
+// Binary form of the -anchors and -clusters diagnostics, written with
+// -binaryDumps.  A dump starts with the magic "BLASRDMP", a 32-bit
+// version and the uint8 type of its records, so that an empty dump
+// still decodes to its text header.  Records follow in native byte
+// order:
+//
+//   uint8 type, uint32 payload length, payload
+//
+// An anchor record ('A') holds the anchors of one strand of a read:
+//
+//   uint32 title length, title, uint8 strand (0 forward, 1 reverse),
+//   uint32 n, then n (uint32 q, uint32 t, uint32 l)
+//
+// A cluster record ('C') holds the statistics of the best cluster:
+//
+//   int64 total size, double p value, int64 n anchors,
+//   int64 read length, int64 score, double read accuracy,
+//   double min expected anchors, int64 aligned length
+//
+// Records of one thread are in the order the thread mapped its reads;
+// records of different threads are interleaved.  blasrDumpDecode
+// prints a dump as text.
+//
+namespace DebugDump {
+static const char Magic[8] = {'B', 'L', 'A', 'S', 'R', 'D', 'M', 'P'};
+static const uint32_t Version = 2;
+static const char AnchorRecord = 'A';
+static const char ClusterRecord = 'C';
+}
+
+class DebugDumpWriter;
+
+//
+// Records of a single mapping thread, appended without locking and
+// handed to the writer in large blocks.
+//
+class DebugDumpBuffer
+{
+public:
+    DebugDumpBuffer() : writer(NULL), recordStart(0) {}
+
+    template <typename T_MatchPosList>
+    void AppendAnchors(const char *title, int strand, const T_MatchPosList &anchors);
+
+    void AppendCluster(int64_t totalSize, double pValue, int64_t nAnchors, int64_t readLength,
+                       int64_t score, double pctSimilarity, double minExpAnchors,
+                       int64_t alignedLength);
+
+    // Hand what is buffered to the writer.
+    void Flush();
+
+private:
+    friend class DebugDumpWriter;
+    DebugDumpWriter *writer;
+    std::vector<char> data;
+    size_t recordStart;
+
+    void BeginRecord(char type);
+
+    void EndRecord();
+
+    template <typename T>
+    void Append(T value);
+};
+
+//
+// Writes the blocks of all threads of one dump to its stream from a
+// thread of its own, so mapping threads only wait when they are more
+// than MaxQueuedBlocks blocks ahead of the disk.
+//
+class DebugDumpWriter
+{
+public:
+    static constexpr size_t BlockSize = 1 << 20;
+    static constexpr size_t MaxQueuedBlocks = 64;
+
+    // recordTypeP is the type of the records of the dump.
+    DebugDumpWriter(int numThreadsP, std::ostream *outP, char recordTypeP);
+
+    ~DebugDumpWriter();
+
+    DebugDumpBuffer *ForThread(int threadIndex);
+
+    // Write the header and start the writer thread.
+    void Start();
+
+    // Flush every thread buffer and wait until all is written.  The
+    // mapping threads must have stopped.
+    void Finish();
+
+private:
+    friend class DebugDumpBuffer;
+    int numThreads;
+    DebugDumpBuffer *threads;
+    std::ostream *out;
+    char recordType;
+    std::deque<std::vector<char> > queue;
+    bool started;
+    bool stopped;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+
+    // Take the contents of block, leaving it empty.
+    void Submit(std::vector<char> &block);
+
+    static void *Run(void *writerP);
+
+    void WriteBlocks();
+};
+
+template <typename T>
+inline void DebugDumpBuffer::Append(T value)
+{
+    size_t end = data.size();
+    data.resize(end + sizeof(T));
+    std::memcpy(&data[end], &value, sizeof(T));
+}
+
+inline void DebugDumpBuffer::BeginRecord(char type)
+{
+    recordStart = data.size();
+    Append<char>(type);
+    Append<uint32_t>(0);
+}
+
+inline void DebugDumpBuffer::EndRecord()
+{
+    uint32_t length = data.size() - recordStart - 1 - sizeof(uint32_t);
+    std::memcpy(&data[recordStart + 1], &length, sizeof(uint32_t));
+    if (data.size() >= DebugDumpWriter::BlockSize) {
+        Flush();
+    }
+}
+
+template <typename T_MatchPosList>
+void DebugDumpBuffer::AppendAnchors(const char *title, int strand, const T_MatchPosList &anchors)
+{
+    if (writer == NULL) {
+        return;
+    }
+    BeginRecord(DebugDump::AnchorRecord);
+    uint32_t titleLength = (title == NULL) ? 0 : std::strlen(title);
+    Append<uint32_t>(titleLength);
+    data.insert(data.end(), title, title + titleLength);
+    Append<uint8_t>(strand);
+    Append<uint32_t>(anchors.size());
+    data.reserve(data.size() + anchors.size() * 3 * sizeof(uint32_t));
+    for (size_t i = 0; i < anchors.size(); i++) {
+        Append<uint32_t>(anchors[i].q);
+        Append<uint32_t>(anchors[i].t);
+        Append<uint32_t>(anchors[i].l);
+    }
+    EndRecord();
+}
+
+inline void DebugDumpBuffer::AppendCluster(int64_t totalSize, double pValue, int64_t nAnchors,
+                                           int64_t readLength, int64_t score, double pctSimilarity,
+                                           double minExpAnchors, int64_t alignedLength)
+{
+    if (writer == NULL) {
+        return;
+    }
+    BeginRecord(DebugDump::ClusterRecord);
+    Append<int64_t>(totalSize);
+    Append<double>(pValue);
+    Append<int64_t>(nAnchors);
+    Append<int64_t>(readLength);
+    Append<int64_t>(score);
+    Append<double>(pctSimilarity);
+    Append<double>(minExpAnchors);
+    Append<int64_t>(alignedLength);
+    EndRecord();
+}
+
+inline void DebugDumpBuffer::Flush()
+{
+    if (writer != NULL and data.size() > 0) {
+        writer->Submit(data);
+    }
+}
+
+inline DebugDumpWriter::DebugDumpWriter(int numThreadsP, std::ostream *outP, char recordTypeP)
+    : numThreads(numThreadsP)
+    , threads(new DebugDumpBuffer[numThreadsP])
+    , out(outP)
+    , recordType(recordTypeP)
+    , started(false)
+    , stopped(false)
+{
+    for (int t = 0; t < numThreads; t++) {
+        threads[t].writer = this;
+    }
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&notEmpty, NULL);
+    pthread_cond_init(&notFull, NULL);
+}
+
+inline DebugDumpWriter::~DebugDumpWriter()
+{
+    if (started) {
+        Finish();
+    }
+    pthread_cond_destroy(&notFull);
+    pthread_cond_destroy(&notEmpty);
+    pthread_mutex_destroy(&lock);
+    delete[] threads;
+}
+
+inline DebugDumpBuffer *DebugDumpWriter::ForThread(int threadIndex)
+{
+    return &threads[threadIndex];
+}
+
+inline void DebugDumpWriter::Start()
+{
+    out->write(DebugDump::Magic, sizeof(DebugDump::Magic));
+    out->write(reinterpret_cast<const char *>(&DebugDump::Version), sizeof(DebugDump::Version));
+    out->put(recordType);
+    if (pthread_create(&thread, NULL, DebugDumpWriter::Run, this) != 0) {
+        std::cout << "ERROR, could not start the dump writer thread." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    started = true;
+}
+
+inline void DebugDumpWriter::Submit(std::vector<char> &block)
+{
+    std::vector<char> full;
+    full.swap(block);
+    pthread_mutex_lock(&lock);
+    while (queue.size() >= MaxQueuedBlocks) {
+        pthread_cond_wait(&notFull, &lock);
+    }
+    queue.push_back(std::vector<char>());
+    queue.back().swap(full);
+    pthread_cond_signal(&notEmpty);
+    pthread_mutex_unlock(&lock);
+    block.reserve(BlockSize);
+}
+
+inline void *DebugDumpWriter::Run(void *writerP)
+{
+    static_cast<DebugDumpWriter *>(writerP)->WriteBlocks();
+    return NULL;
+}
+
+inline void DebugDumpWriter::WriteBlocks()
+{
+    std::vector<char> block;
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (queue.empty() and not stopped) {
+            pthread_cond_wait(&notEmpty, &lock);
+        }
+        if (queue.empty()) {
+            break;
+        }
+        block.swap(queue.front());
+        queue.pop_front();
+        pthread_cond_signal(&notFull);
+        pthread_mutex_unlock(&lock);
+        out->write(&block[0], block.size());
+        block.clear();
+        pthread_mutex_lock(&lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+inline void DebugDumpWriter::Finish()
+{
+    if (not started) {
+        return;
+    }
+    for (int t = 0; t < numThreads; t++) {
+        threads[t].Flush();
+    }
+    pthread_mutex_lock(&lock);
+    stopped = true;
+    pthread_cond_signal(&notEmpty);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    started = false;
+    out->flush();
+}
+
+//
+// Read the records of a dump written by DebugDumpWriter.
+//
+class DebugDumpReader
+{
+public:
+    class Anchor
+    {
+    public:
+        uint32_t q, t, l;
+    };
+
+    // Type of the records of the dump, from its header.
+    char dumpType;
+    char type;
+    // Fields of an anchor record.
+    std::string title;
+    int strand;
+    std::vector<Anchor> anchors;
+    // Fields of a cluster record.
+    int64_t totalSize, nAnchors, readLength, score, alignedLength;
+    double pValue, pctSimilarity, minExpAnchors;
+
+    explicit DebugDumpReader(std::istream &inP) : in(inP), corrupt(false) {}
+
+    // Returns false if the stream does not start with a dump header.
+    bool ReadHeader();
+
+    // Read the next record into the fields above.  Returns false at the
+    // end of the dump or on a truncated or unknown record.
+    bool Next();
+
+    // True if Next stopped on a truncated or unknown record.
+    bool Corrupt() const { return corrupt; }
+
+private:
+    std::istream &in;
+    bool corrupt;
+    std::vector<char> payload;
+    size_t pos;
+
+    template <typename T>
+    bool Take(T &value);
+};
+
+inline bool DebugDumpReader::ReadHeader()
+{
+    char magic[sizeof(DebugDump::Magic)];
+    uint32_t version;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(&version), sizeof(version));
+    in.get(dumpType);
+    return in.good() and std::memcmp(magic, DebugDump::Magic, sizeof(magic)) == 0 and
+           version == DebugDump::Version;
+}
+
+template <typename T>
+inline bool DebugDumpReader::Take(T &value)
+{
+    if (pos + sizeof(T) > payload.size()) {
+        return false;
+    }
+    std::memcpy(&value, &payload[pos], sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+inline bool DebugDumpReader::Next()
+{
+    uint32_t length;
+    if (not in.get(type)) {
+        return false;
+    }
+    corrupt = true;
+    if (not in.read(reinterpret_cast<char *>(&length), sizeof(length))) {
+        return false;
+    }
+    payload.resize(length);
+    if (length > 0 and not in.read(&payload[0], length)) {
+        return false;
+    }
+    pos = 0;
+    if (type == DebugDump::AnchorRecord) {
+        uint32_t titleLength, n;
+        uint8_t strandByte;
+        if (not Take(titleLength) or pos + titleLength > payload.size()) {
+            return false;
+        }
+        title.assign(payload.begin() + pos, payload.begin() + pos + titleLength);
+        pos += titleLength;
+        if (not Take(strandByte) or not Take(n)) {
+            return false;
+        }
+        strand = strandByte;
+        // Check the count against the payload before allocating for it.
+        if (pos + size_t(n) * 3 * sizeof(uint32_t) > payload.size()) {
+            return false;
+        }
+        anchors.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+            if (not Take(anchors[i].q) or not Take(anchors[i].t) or not Take(anchors[i].l)) {
+                return false;
+            }
+        }
+    } else if (type == DebugDump::ClusterRecord) {
+        if (not(Take(totalSize) and Take(pValue) and Take(nAnchors) and Take(readLength) and
+                Take(score) and Take(pctSimilarity) and Take(minExpAnchors) and
+                Take(alignedLength))) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    corrupt = false;
+    return true;
+}
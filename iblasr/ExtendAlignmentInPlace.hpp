@@ -0,0 +1,220 @@
+#pragma once
+
+#include <pbdata/Types.h>
+#include <alignment/datastructures/alignment/Alignment.hpp>
+#include <pbdata/NucConversion.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+//
+// The bases of one strand of the genome, read in place.  Positions on
+// the reverse strand are reverse complement coordinates, as in
+// DNASequence::CopyAsRC, and the bases are complemented as they are
+// read instead of being copied.
+//
+class GenomeStrandBases
+{
+public:
+    GenomeStrandBases(const Nucleotide *genomeSeqP, DNALength genomeLengthP, bool isReverseP);
+
+    Nucleotide operator[](DNALength strandPos) const;
+
+private:
+    const Nucleotide *genomeSeq;
+    DNALength genomeLength;
+    bool isReverse;
+};
+
+inline GenomeStrandBases::GenomeStrandBases(const Nucleotide *genomeSeqP, DNALength genomeLengthP,
+                                            bool isReverseP)
+    : genomeSeq(genomeSeqP), genomeLength(genomeLengthP), isReverse(isReverseP)
+{
+}
+
+inline Nucleotide GenomeStrandBases::operator[](DNALength strandPos) const
+{
+    if (isReverse) {
+        return ReverseComplementNuc[genomeSeq[genomeLength - 1 - strandPos]];
+    }
+    return genomeSeq[strandPos];
+}
+
+//
+// A strand of the genome as the reference sequence of a score
+// function, which reads its bases as seq[pos].
+//
+class GenomeStrandView
+{
+public:
+    GenomeStrandBases seq;
+
+    GenomeStrandView(const Nucleotide *genomeSeqP, DNALength genomeLengthP, bool isReverseP)
+        : seq(genomeSeqP, genomeLengthP, isReverseP)
+    {
+    }
+};
+
+//
+// Band of scores and traceback of ExtendAlignmentInPlace, and the
+// blocks of the extended alignment, kept between calls so that they
+// grow to a high-water mark instead of being reallocated per
+// alignment.
+//
+class ExtensionBuffers
+{
+public:
+    std::vector<int> scores;
+    std::vector<unsigned char> path;
+    std::vector<Block> blocks;
+
+    void Reset();
+};
+
+inline void ExtensionBuffers::Reset()
+{
+    std::vector<int>().swap(scores);
+    std::vector<unsigned char>().swap(path);
+    std::vector<Block>().swap(blocks);
+}
+
+//
+// Extend an alignment past its end (step 1) or before its start (step
+// -1) by banded dynamic programming over the bases of query and
+// target, which are not copied.  With step 1 the first bases compared
+// are query[qStart] and target[tStart], and with step -1 they are
+// query[qStart - 1] and target[tStart - 1].  At most qLength and
+// tLength bases are used.  Bases are scored with scoreFn, a
+// DistanceMatrixScoreFunction or UniformDistanceScoreFunction with a
+// GenomeStrandView reference, and gaps with its ins and del, where
+// lower is better.  The extension stops once maxDrops rows of query
+// bases pass without improving the best score, and is cut at the best
+// scoring cell.  The blocks of the extension are appended to blocks
+// in strand coordinates and in increasing order, its lengths are
+// stored in qExtendLength and tExtendLength, and its score is
+// returned; 0 means nothing was extended.
+//
+template <typename T_Query, typename T_ScoreFn>
+int ExtendAlignmentInPlace(T_Query &query, DNALength qStart, DNALength qLength,
+                           GenomeStrandView &target, DNALength tStart, DNALength tLength, int step,
+                           int k, T_ScoreFn &scoreFn, int maxDrops, ExtensionBuffers &buffers,
+                           std::vector<Block> &blocks, DNALength &qExtendLength,
+                           DNALength &tExtendLength)
+{
+    static const unsigned char Diagonal = 0, Up = 1, Left = 2;
+    static const int Infinity = std::numeric_limits<int>::max() / 2;
+
+    qExtendLength = tExtendLength = 0;
+    if (qLength == 0 or tLength == 0 or k < 0) {
+        return 0;
+    }
+    const int ins = scoreFn.ins;
+    const int del = scoreFn.del;
+    const int width = 2 * k + 1;
+    // Cell (i, j) of the band is column j - i + k of row i.
+    buffers.scores.assign(2 * width, Infinity);
+    int *prevRow = &buffers.scores[0];
+    int *curRow = &buffers.scores[width];
+    buffers.path.resize(width);
+    for (int c = k; c < width and DNALength(c - k) <= tLength; c++) {
+        curRow[c] = (c - k) * del;
+        buffers.path[c] = Left;
+    }
+
+    int bestScore = 0;
+    DNALength bestI = 0, bestJ = 0;
+    int numDrops = 0;
+    DNALength i;
+    for (i = 1; i <= qLength and numDrops < maxDrops; i++) {
+        std::swap(prevRow, curRow);
+        buffers.path.resize((i + 1) * width);
+        unsigned char *pathRow = &buffers.path[i * width];
+        DNALength qPos = (step > 0) ? qStart + i - 1 : qStart - i;
+        int rowBest = Infinity;
+        DNALength rowBestJ = 0;
+        for (int c = 0; c < width; c++) {
+            long j = long(i) - k + c;
+            if (j < 0 or j > long(tLength)) {
+                curRow[c] = Infinity;
+                continue;
+            }
+            int score = Infinity;
+            unsigned char arrow = Diagonal;
+            if (j > 0 and prevRow[c] < Infinity) {
+                DNALength tPos = (step > 0) ? tStart + j - 1 : tStart - j;
+                score = prevRow[c] + scoreFn.Match(target, tPos, query, qPos);
+            }
+            if (c + 1 < width and prevRow[c + 1] < Infinity and prevRow[c + 1] + ins < score) {
+                score = prevRow[c + 1] + ins;
+                arrow = Up;
+            }
+            if (c > 0 and curRow[c - 1] < Infinity and curRow[c - 1] + del < score) {
+                score = curRow[c - 1] + del;
+                arrow = Left;
+            }
+            curRow[c] = score;
+            pathRow[c] = arrow;
+            if (score < rowBest) {
+                rowBest = score;
+                rowBestJ = j;
+            }
+        }
+        if (rowBest < bestScore) {
+            bestScore = rowBest;
+            bestI = i;
+            bestJ = rowBestJ;
+            numDrops = 0;
+        } else {
+            numDrops++;
+        }
+    }
+
+    if (bestI == 0) {
+        return 0;
+    }
+    qExtendLength = bestI;
+    tExtendLength = bestJ;
+
+    //
+    // Trace back from the best cell, collecting the runs of diagonal
+    // steps as blocks, last to first in the direction of the extension.
+    //
+    size_t firstNewBlock = blocks.size();
+    DNALength ti = bestI, tj = bestJ, runLength = 0;
+    while (ti > 0 or tj > 0) {
+        unsigned char arrow =
+            (ti == 0) ? Left : buffers.path[size_t(ti) * width + (long(tj) - long(ti) + k)];
+        if (arrow == Diagonal) {
+            runLength++;
+            ti--;
+            tj--;
+            continue;
+        }
+        if (runLength > 0) {
+            Block block;
+            block.length = runLength;
+            // The run covers bases ti to ti + runLength - 1 of the extension.
+            block.qPos = (step > 0) ? qStart + ti : qStart - ti - runLength;
+            block.tPos = (step > 0) ? tStart + tj : tStart - tj - runLength;
+            blocks.push_back(block);
+            runLength = 0;
+        }
+        if (arrow == Up) {
+            ti--;
+        } else {
+            tj--;
+        }
+    }
+    if (runLength > 0) {
+        Block block;
+        block.length = runLength;
+        block.qPos = (step > 0) ? qStart : qStart - runLength;
+        block.tPos = (step > 0) ? tStart : tStart - runLength;
+        blocks.push_back(block);
+    }
+    if (step > 0) {
+        std::reverse(blocks.begin() + firstNewBlock, blocks.end());
+    }
+    return bestScore;
+}
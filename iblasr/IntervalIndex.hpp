@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+//
+// Find which of a fixed set of closed intervals [start, end] intersect
+// a query interval, without comparing the query to every interval.
+// Intervals are identified by their index in the vectors given to
+// Initialize, and only the active ones are reported.  The intervals
+// are kept sorted by start under a tree of the maximum end of each
+// range, so a query only descends into ranges holding an interval
+// that reaches the query start, and costs O((k + 1) log n) for k
+// intervals found.
+//
+class IntervalIndex
+{
+public:
+    IntervalIndex();
+
+    // Index the intervals [starts[i], ends[i]].  All start inactive.
+    void Initialize(const std::vector<long> &starts, const std::vector<long> &ends);
+
+    void Activate(int id);
+
+    void Deactivate(int id);
+
+    // Append the ids of the active intervals that intersect [start,
+    // end] to ids, in no particular order.
+    void FindIntersecting(long start, long end, std::vector<int> &ids) const;
+
+private:
+    static constexpr long Inactive = std::numeric_limits<long>::min();
+
+    std::vector<int> order;  // ids, by increasing start
+    std::vector<int> rank;   // position of each id in order
+    std::vector<long> sortedStarts;
+    std::vector<long> ends;
+    size_t numLeaves;
+    std::vector<long> maxEnd;  // 1-based heap over numLeaves leaves
+
+    void Update(int id, long value);
+
+    void Collect(size_t node, size_t nodeBegin, size_t nodeEnd, size_t rangeEnd, long start,
+                 std::vector<int> &ids) const;
+};
+
+inline IntervalIndex::IntervalIndex() : numLeaves(0) {}
+
+inline void IntervalIndex::Initialize(const std::vector<long> &starts,
+                                      const std::vector<long> &endsP)
+{
+    assert(starts.size() == endsP.size());
+    ends = endsP;
+    order.resize(starts.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&starts](int a, int b) { return starts[a] < starts[b]; });
+    rank.resize(order.size());
+    sortedStarts.resize(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        rank[order[i]] = i;
+        sortedStarts[i] = starts[order[i]];
+    }
+    numLeaves = 1;
+    while (numLeaves < order.size()) {
+        numLeaves *= 2;
+    }
+    maxEnd.assign(2 * numLeaves, Inactive);
+}
+
+inline void IntervalIndex::Activate(int id) { Update(id, ends[id]); }
+
+inline void IntervalIndex::Deactivate(int id) { Update(id, Inactive); }
+
+inline void IntervalIndex::Update(int id, long value)
+{
+    size_t node = numLeaves + rank[id];
+    maxEnd[node] = value;
+    for (node /= 2; node > 0; node /= 2) {
+        maxEnd[node] = std::max(maxEnd[2 * node], maxEnd[2 * node + 1]);
+    }
+}
+
+inline void IntervalIndex::FindIntersecting(long start, long end, std::vector<int> &ids) const
+{
+    // Only intervals starting at or before end can intersect.
+    size_t rangeEnd =
+        std::upper_bound(sortedStarts.begin(), sortedStarts.end(), end) - sortedStarts.begin();
+    if (rangeEnd > 0) {
+        Collect(1, 0, numLeaves, rangeEnd, start, ids);
+    }
+}
+
+inline void IntervalIndex::Collect(size_t node, size_t nodeBegin, size_t nodeEnd, size_t rangeEnd,
+                                   long start, std::vector<int> &ids) const
+{
+    if (nodeBegin >= rangeEnd or maxEnd[node] == Inactive or maxEnd[node] < start) {
+        return;
+    }
+    if (node >= numLeaves) {
+        ids.push_back(order[nodeBegin]);
+        return;
+    }
+    size_t nodeMid = (nodeBegin + nodeEnd) / 2;
+    Collect(2 * node, nodeBegin, nodeMid, rangeEnd, start, ids);
+    Collect(2 * node + 1, nodeMid, nodeEnd, rangeEnd, start, ids);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+//
+// Cores that mapping threads may borrow to map one long read with
+// several threads (-intraReadThreads).  At the start these are the
+// online cores not used by the -nproc mapping threads, and each mapping
+// thread returns its own core when it runs out of reads, so the long
+// reads at the end of a run are spread over the cores left idle.
+//
+class IdleCores
+{
+public:
+    explicit IdleCores(int numCores);
+
+    // Cores that are neither mapping nor borrowed, given nProc mapping
+    // threads.
+    static int NumUnused(int nProc);
+
+    // Borrow up to maxCores cores.  Returns how many were borrowed,
+    // which may be 0.
+    int Acquire(int maxCores);
+
+    void Release(int numCores);
+
+private:
+    std::atomic<int> available;
+};
+
+inline IdleCores::IdleCores(int numCores) : available(std::max(numCores, 0)) {}
+
+inline int IdleCores::NumUnused(int nProc)
+{
+    long numOnline = sysconf(_SC_NPROCESSORS_ONLN);
+    return std::max(int(numOnline) - nProc, 0);
+}
+
+inline int IdleCores::Acquire(int maxCores)
+{
+    int current = available.load();
+    int numAcquired = 0;
+    do {
+        numAcquired = std::min(current, maxCores);
+        if (numAcquired <= 0) {
+            return 0;
+        }
+    } while (not available.compare_exchange_weak(current, current - numAcquired));
+    return numAcquired;
+}
+
+inline void IdleCores::Release(int numCores)
+{
+    if (numCores > 0) {
+        available.fetch_add(numCores);
+    }
+}
+
+//
+// Run one piece of the mapping of a read on a helper thread.
+//
+class IntraReadTask
+{
+public:
+    IntraReadTask() : started(false) {}
+
+    void Start(const std::function<void()> &workP);
+
+    void Join();
+
+private:
+    std::function<void()> work;
+    pthread_t thread;
+    bool started;
+
+    static void *Run(void *taskP);
+};
+
+inline void IntraReadTask::Start(const std::function<void()> &workP)
+{
+    work = workP;
+    if (pthread_create(&thread, NULL, IntraReadTask::Run, this) == 0) {
+        started = true;
+    } else {
+        // No thread to be had, do the work here.
+        work();
+    }
+}
+
+inline void *IntraReadTask::Run(void *taskP)
+{
+    static_cast<IntraReadTask *>(taskP)->work();
+    return NULL;
+}
+
+inline void IntraReadTask::Join()
+{
+    if (started) {
+        pthread_join(thread, NULL);
+        started = false;
+    }
+}
@@ -9,6 +9,9 @@
 #include <alignment/tuples/DNATuple.hpp>
 #include <alignment/tuples/TupleList.hpp>
 
+#include "ExtendAlignmentInPlace.hpp"
+#include "RadixSortMatchPos.hpp"
+
 #include <vector>
 
 //
@@ -29,6 +32,7 @@ public:
     std::vector<Arrow> affinePathMat;
     std::vector<ChainedMatchPos> matchPosList;
     std::vector<ChainedMatchPos> rcMatchPosList;
+    MatchPosSortBuffers matchPosSortBuffers;
     std::vector<BasicEndpoint<ChainedMatchPos> > globalChainEndpointBuffer;
     std::vector<Fragment> sdpFragmentSet, sdpPrefixFragmentSet, sdpSuffixFragmentSet;
     TupleList<PositionDNATuple> sdpCachedTargetTupleList;
@@ -42,8 +46,16 @@ public:
     std::vector<float> lnDelPValueMat;
     std::vector<float> lnMatchPValueMat;
     std::vector<int> clusterNumBases;
+    ExtensionBuffers extensionBuffers;
+    // Masked copies of the bases of a read and its reverse complement
+    // referenced by subread views (see MakeSubreadViews).  Everything
+    // outside of the subread being mapped is 'N'.
+    std::vector<Nucleotide> subreadMask, subreadMaskRC;
     ClusterList clusterList;
     ClusterList revStrandClusterList;
+    // Buffers of the helper threads that map a long read along with
+    // this one (-intraReadThreads).
+    std::vector<MappingBuffers> helperBuffers;
 
     void Reset(void);
 };
@@ -60,6 +72,8 @@ inline void MappingBuffers::Reset(void)
     std::vector<Arrow>().swap(pathMat);
     std::vector<ChainedMatchPos>().swap(matchPosList);
     std::vector<ChainedMatchPos>().swap(rcMatchPosList);
+    matchPosSortBuffers.Reset();
+    extensionBuffers.Reset();
     std::vector<BasicEndpoint<ChainedMatchPos> >().swap(globalChainEndpointBuffer);
     std::vector<Fragment>().swap(sdpFragmentSet);
     std::vector<Fragment>().swap(sdpPrefixFragmentSet);
@@ -75,4 +89,7 @@ inline void MappingBuffers::Reset(void)
     std::vector<float>().swap(lnDelPValueMat);
     std::vector<float>().swap(lnMatchPValueMat);
     std::vector<int>().swap(clusterNumBases);
+    std::vector<Nucleotide>().swap(subreadMask);
+    std::vector<Nucleotide>().swap(subreadMaskRC);
+    std::vector<MappingBuffers>().swap(helperBuffers);
 }
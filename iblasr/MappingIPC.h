@@ -2,7 +2,10 @@
 
 #include <pthread.h>
 
+#include "DebugDump.hpp"
+#include "IntraReadParallel.hpp"
 #include "MappingParameters.h"
+#include "MappingTelemetry.hpp"
 
 #include <alignment/MappingMetrics.hpp>
 #include <alignment/bwt/BWT.hpp>
@@ -40,6 +43,16 @@ public:
     std::ostream *anchorFilePtr;
     std::ostream *clusterFilePtr;
     std::ostream *lcpBoundsOutPtr;
+    // Live per-stage counters of the thread, NULL unless --progress or
+    // --stageStats is given.
+    ThreadTelemetry *telemetry;
+    // Cores the thread may borrow to map a long read, NULL unless
+    // -intraReadThreads is given.
+    IdleCores *idleCores;
+    // Buffers of the -anchors and -clusters dumps of the thread, NULL
+    // unless -binaryDumps is given.
+    DebugDumpBuffer *anchorDump;
+    DebugDumpBuffer *clusterDump;
 
     // Declare a semaphore for blocking on reading from the same hdhf file.
 
@@ -99,5 +112,9 @@ public:
         unalignedFilePtr = unalignedFileP;
         anchorFilePtr = anchorFilePtrP;
         clusterFilePtr = clusterFilePtrP;
+        telemetry = NULL;
+        idleCores = NULL;
+        anchorDump = NULL;
+        clusterDump = NULL;
     }
 };
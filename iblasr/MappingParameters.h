@@ -39,6 +39,12 @@ public:
     int maxScore;
     int argi;
     int nProc;
+    int prefetchReads;
+    int progressInterval;
+    std::string stageStatsFileName;
+    int intraReadThreads;
+    int intraReadMinLength;
+    int intraReadIdleCores;
     int globalChainType;
     SAMOutput::Clipping clipping;
     std::string clippingString;
@@ -64,6 +70,7 @@ public:
     std::string indexFileName;
     std::string anchorFileName;
     std::string clusterFileName;
+    bool binaryDumps;
     int nBest;
     int printWindow;
     int doCondense;
@@ -138,6 +145,7 @@ public:
     bool readSeparateRegionTable;
     bool readSeparateCcsFofn;
     std::string regionTableFileName;
+    bool streamRegionTable;
     std::string ccsFofnFileName;
     //float averageMismatchScore;
     bool mapSubreadsSeparately;
@@ -208,6 +216,10 @@ public:
     HitPolicy hitPolicy;
     bool enableHiddenPaths;
     bool polymeraseMode;
+    // Which quality tracks of a read are used by scoring or output,
+    // derived from the scoring mode and output format in MakeSane.
+    bool needReadQuality;
+    bool needReadQVs;
 
     void Init()
     {
@@ -233,6 +245,12 @@ public:
         maxScore = -200;
         argi = 1;
         nProc = 1;
+        prefetchReads = 0;
+        progressInterval = 0;
+        stageStatsFileName = "";
+        intraReadThreads = 0;
+        intraReadMinLength = 50000;
+        intraReadIdleCores = -1;
         readsFileNames.clear();
         queryFileNames.clear();
         genomeFileName = "";
@@ -244,6 +262,7 @@ public:
         bwtFileName = "";
         indexFileName = "";
         anchorFileName = "";
+        binaryDumps = false;
         outFileName = "";
         nBest = 10;
         nCandidates = 10;
@@ -312,6 +331,7 @@ public:
         readSeparateRegionTable = false;
         readSeparateCcsFofn = false;
         regionTableFileName = "";
+        streamRegionTable = false;
         ccsFofnFileName = "";
         mapSubreadsSeparately = true;
         concordant = false;
@@ -388,6 +408,8 @@ public:
         enableHiddenPaths = false;  //turn off hidden paths.
 
         polymeraseMode = false;
+        needReadQuality = true;
+        needReadQVs = true;
     }
 
     MappingParameters()
@@ -759,6 +781,20 @@ public:
 
         // Set filter criteria and hit policy
         ResetFilterAndHit();
+
+        DetermineRequiredQVs();
+    }
+
+    //
+    // Quality values are only looked at when aligning with
+    // --useQuality, and are only written in SAM/BAM.  Everything
+    // else (e.g. -m 4 with the default scoring) only needs bases.
+    //
+    void DetermineRequiredQVs()
+    {
+        bool printQVs = (printFormat == SAM or printFormat == BAM);
+        needReadQVs = (not ignoreQualities or printQVs);
+        needReadQuality = (needReadQVs or minAvgQual != 0 or qualityLowerCaseThreshold != 0);
     }
     void ResetFilterAndHit(void)
     {
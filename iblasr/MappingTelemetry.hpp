@@ -0,0 +1,370 @@
+#pragma once
+
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <pbdata/utils/TimeUtils.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+//
+// Stages of mapping a zmw that are timed by the telemetry.  The wait
+// stages are the time spent blocked on semaphores.reader (or the
+// prefetch queue) and semaphores.writer.
+//
+enum TelemetryStage
+{
+    ReaderWaitStage,
+    SeedingStage,
+    ChainingStage,
+    SDPStage,
+    RefinementStage,
+    ConcordantStage,
+    WriterWaitStage,
+    NumTelemetryStages
+};
+
+inline const char *TelemetryStageName(int stage)
+{
+    static const char *names[NumTelemetryStages] = {"readerWait", "seeding",    "chaining",  "sdp",
+                                                    "refinement", "concordant", "writerWait"};
+    return names[stage];
+}
+
+//
+// Count and latency histogram of one stage.  Bucket b holds latencies
+// in [2^b, 2^(b+1)) microseconds, except bucket 0 which also holds
+// everything under a microsecond.  Only the owning mapping thread
+// writes; the reporter reads concurrently, so everything is atomic.
+//
+class StageLatency
+{
+public:
+    static const int NumBuckets = 32;
+
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> totalNanoseconds;
+    std::atomic<uint64_t> maxNanoseconds;
+    std::atomic<uint64_t> buckets[NumBuckets];
+
+    StageLatency();
+
+    void Record(uint64_t nanoseconds);
+
+    // Upper bound, in microseconds, of the bucket holding quantile q.
+    uint64_t Quantile(double q) const;
+};
+
+inline StageLatency::StageLatency() : count(0), totalNanoseconds(0), maxNanoseconds(0)
+{
+    for (int b = 0; b < NumBuckets; b++) {
+        buckets[b] = 0;
+    }
+}
+
+inline void StageLatency::Record(uint64_t nanoseconds)
+{
+    uint64_t microseconds = nanoseconds / 1000;
+    int b = 0;
+    while (microseconds > 1 and b < NumBuckets - 1) {
+        microseconds >>= 1;
+        b++;
+    }
+    buckets[b].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > maxNanoseconds.load(std::memory_order_relaxed)) {
+        maxNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+inline uint64_t StageLatency::Quantile(double q) const
+{
+    uint64_t n = count.load(std::memory_order_relaxed);
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * n);
+    uint64_t seen = 0;
+    for (int b = 0; b < NumBuckets; b++) {
+        seen += buckets[b].load(std::memory_order_relaxed);
+        if (seen > rank) {
+            return uint64_t(1) << (b + 1);
+        }
+    }
+    return uint64_t(1) << NumBuckets;
+}
+
+//
+// Counters of a single mapping thread.
+//
+class ThreadTelemetry
+{
+public:
+    StageLatency stages[NumTelemetryStages];
+    std::atomic<uint64_t> numReads;
+    std::atomic<uint64_t> numBases;
+    std::atomic<uint64_t> numBytesWritten;
+
+    ThreadTelemetry() : numReads(0), numBases(0), numBytesWritten(0) {}
+
+    void RecordRead(uint64_t length)
+    {
+        numReads.fetch_add(1, std::memory_order_relaxed);
+        numBases.fetch_add(length, std::memory_order_relaxed);
+    }
+
+    void RecordBytesWritten(uint64_t nBytes)
+    {
+        numBytesWritten.fetch_add(nBytes, std::memory_order_relaxed);
+    }
+};
+
+//
+// Time one stage for a thread, in the Tick/Tock style of
+// MappingMetrics clocks.  Does nothing when telemetry is off.
+//
+class TelemetryTimer
+{
+public:
+    explicit TelemetryTimer(ThreadTelemetry *telemetryP) : telemetry(telemetryP) {}
+
+    void Tick()
+    {
+        if (telemetry != NULL) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    void Tock(TelemetryStage stage)
+    {
+        if (telemetry != NULL) {
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+            telemetry->stages[stage].Record(elapsed.count());
+        }
+    }
+
+private:
+    ThreadTelemetry *telemetry;
+    std::chrono::steady_clock::time_point start;
+};
+
+//
+// Live view of a mapping run.  Every intervalSeconds a progress line
+// with reads/sec, bases/sec and the share of thread time spent waiting
+// on the reader and writer is printed to std::cerr, and when a stats
+// file is given it is rewritten with the per-thread, per-stage counts
+// and latency quantiles.  Both are also produced once at Finish.
+//
+class MappingTelemetry
+{
+public:
+    MappingTelemetry(int numThreadsP, int intervalSecondsP, const std::string &statsFileNameP);
+
+    ~MappingTelemetry();
+
+    ThreadTelemetry *ForThread(int threadIndex);
+
+    // Start the reporter thread.
+    void Start();
+
+    // Stop the reporter thread and report the totals of the run.
+    void Finish();
+
+private:
+    int numThreads;
+    ThreadTelemetry *threads;
+    int intervalSeconds;
+    std::string statsFileName;
+    bool started;
+    bool stopped;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point lastReportTime;
+    uint64_t lastNumReads;
+    uint64_t lastNumBases;
+    uint64_t lastWaitNanoseconds[NumTelemetryStages];
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t stop;
+
+    static void *Run(void *telemetryP);
+
+    void ReportPeriodically();
+
+    void PrintProgress(bool isFinal);
+
+    void WriteStats();
+};
+
+inline MappingTelemetry::MappingTelemetry(int numThreadsP, int intervalSecondsP,
+                                          const std::string &statsFileNameP)
+    : numThreads(numThreadsP)
+    , threads(new ThreadTelemetry[numThreadsP])
+    , intervalSeconds(intervalSecondsP)
+    , statsFileName(statsFileNameP)
+    , started(false)
+    , stopped(false)
+    , lastNumReads(0)
+    , lastNumBases(0)
+{
+    for (int s = 0; s < NumTelemetryStages; s++) {
+        lastWaitNanoseconds[s] = 0;
+    }
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&stop, NULL);
+    startTime = lastReportTime = std::chrono::steady_clock::now();
+}
+
+inline MappingTelemetry::~MappingTelemetry()
+{
+    if (started) {
+        Finish();
+    }
+    pthread_cond_destroy(&stop);
+    pthread_mutex_destroy(&lock);
+    delete[] threads;
+}
+
+inline ThreadTelemetry *MappingTelemetry::ForThread(int threadIndex)
+{
+    return &threads[threadIndex];
+}
+
+inline void MappingTelemetry::Start()
+{
+    startTime = lastReportTime = std::chrono::steady_clock::now();
+    started = true;
+    pthread_create(&thread, NULL, MappingTelemetry::Run, this);
+}
+
+inline void *MappingTelemetry::Run(void *telemetryP)
+{
+    static_cast<MappingTelemetry *>(telemetryP)->ReportPeriodically();
+    return NULL;
+}
+
+inline void MappingTelemetry::ReportPeriodically()
+{
+    pthread_mutex_lock(&lock);
+    while (not stopped) {
+        if (intervalSeconds == 0) {
+            // Only the totals are reported.
+            pthread_cond_wait(&stop, &lock);
+            continue;
+        }
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        struct timespec deadline;
+        deadline.tv_sec = now.tv_sec + intervalSeconds;
+        deadline.tv_nsec = now.tv_usec * 1000;
+        while (not stopped and pthread_cond_timedwait(&stop, &lock, &deadline) == 0) {
+        }
+        if (not stopped) {
+            pthread_mutex_unlock(&lock);
+            PrintProgress(false);
+            WriteStats();
+            pthread_mutex_lock(&lock);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+inline void MappingTelemetry::Finish()
+{
+    if (not started) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    stopped = true;
+    pthread_cond_signal(&stop);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    started = false;
+    if (intervalSeconds > 0) {
+        PrintProgress(true);
+    }
+    WriteStats();
+}
+
+inline void MappingTelemetry::PrintProgress(bool isFinal)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    uint64_t numReads = 0, numBases = 0;
+    uint64_t waitNanoseconds[NumTelemetryStages] = {0};
+    for (int t = 0; t < numThreads; t++) {
+        numReads += threads[t].numReads.load(std::memory_order_relaxed);
+        numBases += threads[t].numBases.load(std::memory_order_relaxed);
+        for (int s = 0; s < NumTelemetryStages; s++) {
+            waitNanoseconds[s] += threads[t].stages[s].totalNanoseconds.load();
+        }
+    }
+
+    //
+    // The final line is averaged over the whole run, the periodic ones
+    // over the last interval.
+    //
+    std::chrono::steady_clock::time_point since = isFinal ? startTime : lastReportTime;
+    uint64_t sinceReads = isFinal ? 0 : lastNumReads;
+    uint64_t sinceBases = isFinal ? 0 : lastNumBases;
+    double seconds = std::chrono::duration<double>(now - since).count();
+    if (seconds <= 0) {
+        seconds = 1e-9;
+    }
+    double threadNanoseconds = seconds * 1e9 * numThreads;
+    uint64_t readerWait = waitNanoseconds[ReaderWaitStage];
+    uint64_t writerWait = waitNanoseconds[WriterWaitStage];
+    if (not isFinal) {
+        readerWait -= lastWaitNanoseconds[ReaderWaitStage];
+        writerWait -= lastWaitNanoseconds[WriterWaitStage];
+    }
+
+    std::cerr << "[INFO] " << GetTimestamp() << " [blasr] " << (isFinal ? "total" : "progress")
+              << ": " << numReads << " reads, " << numBases << " bases, "
+              << (numReads - sinceReads) / seconds << " reads/s, "
+              << (numBases - sinceBases) / seconds << " bases/s, reader wait "
+              << 100 * readerWait / threadNanoseconds << "%, writer wait "
+              << 100 * writerWait / threadNanoseconds << "%" << std::endl;
+
+    lastReportTime = now;
+    lastNumReads = numReads;
+    lastNumBases = numBases;
+    for (int s = 0; s < NumTelemetryStages; s++) {
+        lastWaitNanoseconds[s] = waitNanoseconds[s];
+    }
+}
+
+inline void MappingTelemetry::WriteStats()
+{
+    if (statsFileName == "") {
+        return;
+    }
+    std::ofstream statsOut(statsFileName.c_str(), std::ios::out | std::ios::trunc);
+    if (not statsOut.good()) {
+        std::cerr << "WARNING, could not write stage statistics to " << statsFileName << std::endl;
+        return;
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    statsOut << "thread\treads\tbases\tbytesWritten\telapsedSeconds" << std::endl;
+    for (int t = 0; t < numThreads; t++) {
+        statsOut << t << "\t" << threads[t].numReads.load() << "\t" << threads[t].numBases.load()
+                 << "\t" << threads[t].numBytesWritten.load() << "\t" << seconds << std::endl;
+    }
+    statsOut << std::endl;
+    statsOut << "thread\tstage\tcount\tseconds\tp50us\tp99us\tmaxus" << std::endl;
+    for (int t = 0; t < numThreads; t++) {
+        for (int s = 0; s < NumTelemetryStages; s++) {
+            const StageLatency &stage = threads[t].stages[s];
+            statsOut << t << "\t" << TelemetryStageName(s) << "\t" << stage.count.load() << "\t"
+                     << stage.totalNanoseconds.load() / 1e9 << "\t" << stage.Quantile(0.5) << "\t"
+                     << stage.Quantile(0.99) << "\t" << stage.maxNanoseconds.load() / 1000
+                     << std::endl;
+        }
+    }
+}
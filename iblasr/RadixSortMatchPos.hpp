@@ -0,0 +1,124 @@
+#pragma once
+
+#include <alignment/algorithms/anchoring/MapBySuffixArray.hpp>
+#include <alignment/datastructures/anchoring/MatchPos.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+//
+// Scratch space of RadixSortMatchPosList, kept between calls so that
+// it grows to a high-water mark instead of being reallocated per read.
+//
+class MatchPosSortBuffers
+{
+public:
+    class Key
+    {
+    public:
+        uint64_t key;
+        UInt index;
+    };
+    std::vector<Key> keys, keysScratch;
+    std::vector<UInt> digitCounts;
+    std::vector<ChainedMatchPos> matchPosScratch;
+
+    void Reset();
+};
+
+inline void MatchPosSortBuffers::Reset()
+{
+    std::vector<Key>().swap(keys);
+    std::vector<Key>().swap(keysScratch);
+    std::vector<UInt>().swap(digitCounts);
+    std::vector<ChainedMatchPos>().swap(matchPosScratch);
+}
+
+//
+// Sort anchors by target and then query position, the order of
+// SortMatchPosList, with a least significant digit radix sort.  The
+// (t, q) pairs are packed into one key, offset by their minimums and
+// shifted only by the width of the query positions, so that anchors of
+// a read use few digits, and digits that are equal in every key are
+// skipped.  Keys are sorted along with the index of their anchor, and
+// the anchors are moved once at the end.  Anchors with equal (t, q)
+// keep their order.  Short lists are sorted with SortMatchPosList.
+//
+inline void RadixSortMatchPosList(std::vector<ChainedMatchPos> &matchPosList,
+                                  MatchPosSortBuffers &buffers)
+{
+    static const size_t MinRadixSortLength = 256;
+    static const int MaxDigitBits = 16;
+
+    size_t n = matchPosList.size();
+    if (n < MinRadixSortLength) {
+        SortMatchPosList(matchPosList);
+        return;
+    }
+
+    DNALength minT = matchPosList[0].t, maxT = minT;
+    DNALength minQ = matchPosList[0].q, maxQ = minQ;
+    for (size_t i = 1; i < n; i++) {
+        minT = std::min(minT, matchPosList[i].t);
+        maxT = std::max(maxT, matchPosList[i].t);
+        minQ = std::min(minQ, matchPosList[i].q);
+        maxQ = std::max(maxQ, matchPosList[i].q);
+    }
+    int qBits = 0, tBits = 0;
+    while (qBits < 64 and (uint64_t(maxQ - minQ) >> qBits) != 0) {
+        qBits++;
+    }
+    while (tBits < 64 and (uint64_t(maxT - minT) >> tBits) != 0) {
+        tBits++;
+    }
+
+    //
+    // Use as few passes as buckets allow, with no more buckets than
+    // about one per anchor, as each pass scans all buckets.
+    //
+    int maxDigitBits = 8;
+    while (maxDigitBits < MaxDigitBits and (size_t(1) << (maxDigitBits + 1)) <= n) {
+        maxDigitBits++;
+    }
+    int numDigits = (qBits + tBits + maxDigitBits - 1) / maxDigitBits;
+    int digitBits = (numDigits > 0) ? (qBits + tBits + numDigits - 1) / numDigits : 1;
+    UInt numBuckets = UInt(1) << digitBits;
+
+    buffers.keys.resize(n);
+    buffers.keysScratch.resize(n);
+    buffers.digitCounts.assign(numDigits * numBuckets, 0);
+    for (size_t i = 0; i < n; i++) {
+        MatchPosSortBuffers::Key &k = buffers.keys[i];
+        k.key = (uint64_t(matchPosList[i].t - minT) << qBits) | (matchPosList[i].q - minQ);
+        k.index = i;
+        for (int d = 0; d < numDigits; d++) {
+            buffers.digitCounts[d * numBuckets + ((k.key >> (d * digitBits)) & (numBuckets - 1))]++;
+        }
+    }
+
+    for (int d = 0; d < numDigits; d++) {
+        UInt *counts = &buffers.digitCounts[d * numBuckets];
+        if (counts[(buffers.keys[0].key >> (d * digitBits)) & (numBuckets - 1)] == n) {
+            // Every key has this digit.
+            continue;
+        }
+        UInt offset = 0;
+        for (UInt b = 0; b < numBuckets; b++) {
+            UInt count = counts[b];
+            counts[b] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            const MatchPosSortBuffers::Key &k = buffers.keys[i];
+            buffers.keysScratch[counts[(k.key >> (d * digitBits)) & (numBuckets - 1)]++] = k;
+        }
+        buffers.keys.swap(buffers.keysScratch);
+    }
+
+    buffers.matchPosScratch.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        buffers.matchPosScratch[i] = matchPosList[buffers.keys[i].index];
+    }
+    matchPosList.swap(buffers.matchPosScratch);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <alignment/files/ReaderAgglomerate.hpp>
+#include <pbdata/SMRTSequence.hpp>
+
+#include <cassert>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//
+// Reads decoded together by the prefetch thread.  When grouping by
+// zmw this holds all subreads of one zmw, otherwise a single record.
+//
+class PrefetchedReads
+{
+public:
+    std::vector<SMRTSequence> reads;
+    std::string readGroupId;
+    int associatedRandInt;
+
+    PrefetchedReads() : associatedRandInt(0) {}
+};
+
+//
+// Decode reads from BAM/dataset input on a dedicated thread.  The
+// BGZF inflation and record to SMRTSequence conversion done in
+// ReaderAgglomerate::GetNext happen off of the mapping threads, which
+// only take already-decoded zmws off of a bounded queue.  The queue is
+// first in first out, so reads are handed to mappers in file order.
+//
+class ReadPrefetcher
+{
+public:
+    ReadPrefetcher(ReaderAgglomerate *readerP, size_t capacityP, bool groupByZmwP);
+
+    ~ReadPrefetcher();
+
+    // Start the decode thread.
+    void Start();
+
+    // Block until decoded reads are available and swap them into
+    // reads, which holds a single read unless grouping by zmw.  Returns
+    // false once the input is exhausted.
+    bool GetNext(std::vector<SMRTSequence> &reads, std::string &readGroupId,
+                 int &associatedRandInt);
+
+    // Stop decoding (mappers may stop early, e.g. past --holeNumbers),
+    // and wait for the decode thread to exit.  Anything left in the
+    // queue is discarded.
+    void Finish();
+
+private:
+    ReaderAgglomerate *reader;
+    size_t capacity;
+    bool groupByZmw;
+    bool started;
+    bool exhausted;
+    bool cancelled;
+    std::deque<PrefetchedReads> queue;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+
+    static void *Run(void *prefetcherP);
+
+    void Decode();
+};
+
+inline ReadPrefetcher::ReadPrefetcher(ReaderAgglomerate *readerP, size_t capacityP,
+                                      bool groupByZmwP)
+    : reader(readerP)
+    , capacity(capacityP > 0 ? capacityP : 1)
+    , groupByZmw(groupByZmwP)
+    , started(false)
+    , exhausted(false)
+    , cancelled(false)
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&notEmpty, NULL);
+    pthread_cond_init(&notFull, NULL);
+}
+
+inline ReadPrefetcher::~ReadPrefetcher()
+{
+    Finish();
+    pthread_cond_destroy(&notFull);
+    pthread_cond_destroy(&notEmpty);
+    pthread_mutex_destroy(&lock);
+}
+
+inline void ReadPrefetcher::Start()
+{
+    assert(started == false);
+    if (pthread_create(&thread, NULL, ReadPrefetcher::Run, this) != 0) {
+        std::cout << "ERROR, could not start the read prefetch thread." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    started = true;
+}
+
+inline void *ReadPrefetcher::Run(void *prefetcherP)
+{
+    static_cast<ReadPrefetcher *>(prefetcherP)->Decode();
+    return NULL;
+}
+
+inline void ReadPrefetcher::Decode()
+{
+    while (true) {
+        //
+        // Decode outside of the lock so that mappers can keep taking
+        // reads off of the queue while the next record is inflated.
+        //
+        PrefetchedReads decoded;
+        int hasNext;
+        if (groupByZmw) {
+            hasNext = reader->GetNext(decoded.reads, decoded.associatedRandInt);
+        } else {
+            decoded.reads.resize(1);
+            hasNext = reader->GetNext(decoded.reads[0], decoded.associatedRandInt);
+        }
+        decoded.readGroupId = reader->readGroupId;
+
+        pthread_mutex_lock(&lock);
+        while (queue.size() >= capacity and not cancelled) {
+            pthread_cond_wait(&notFull, &lock);
+        }
+        if (hasNext == 0 or cancelled) {
+            exhausted = true;
+            pthread_cond_broadcast(&notEmpty);
+            pthread_mutex_unlock(&lock);
+            return;
+        }
+        // Swap rather than copy, the reads may carry every QV track.
+        queue.push_back(PrefetchedReads());
+        queue.back().reads.swap(decoded.reads);
+        queue.back().readGroupId.swap(decoded.readGroupId);
+        queue.back().associatedRandInt = decoded.associatedRandInt;
+        pthread_cond_signal(&notEmpty);
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+inline bool ReadPrefetcher::GetNext(std::vector<SMRTSequence> &reads, std::string &readGroupId,
+                                    int &associatedRandInt)
+{
+    pthread_mutex_lock(&lock);
+    while (queue.empty() and not exhausted) {
+        pthread_cond_wait(&notEmpty, &lock);
+    }
+    if (queue.empty()) {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    reads.swap(queue.front().reads);
+    readGroupId.swap(queue.front().readGroupId);
+    associatedRandInt = queue.front().associatedRandInt;
+    queue.pop_front();
+    pthread_cond_signal(&notFull);
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+inline void ReadPrefetcher::Finish()
+{
+    if (not started) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    cancelled = true;
+    pthread_cond_broadcast(&notFull);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    started = false;
+    queue.clear();
+}
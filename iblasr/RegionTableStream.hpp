@@ -0,0 +1,178 @@
+#pragma once
+
+#include <hdf/HDF2DArray.hpp>
+#include <hdf/HDFAtom.hpp>
+#include <hdf/HDFFile.hpp>
+#include <hdf/HDFGroup.hpp>
+#include <pbdata/reads/RegionAnnotation.hpp>
+#include <pbdata/reads/RegionTable.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//
+// Read a region table alongside the reads instead of loading the
+// whole table up front.  Rows of a region table are sorted by hole
+// number, as are the reads of a bax/pls.h5 file, so the regions of
+// each zmw are found by advancing a cursor.  Rows are read ChunkRows
+// at a time, one HDF5 read per chunk rather than per row, and only a
+// chunk and the rows of one zmw are held in memory at a time.
+//
+class RegionTableStream
+{
+public:
+    static const size_t ChunkRows = 4096;
+
+    RegionTableStream();
+
+    ~RegionTableStream();
+
+    // Open the region table of an HDF file.  Returns 0 on failure.
+    int Initialize(const std::string &regionTableFileNameP);
+
+    // Replace zmwRegionTable with the regions of one zmw.  Returns
+    // false if there are no regions for the zmw.  Hole numbers are
+    // expected to be increasing; asking for an earlier zmw rescans the
+    // table from the start.
+    bool GetZmwRegions(UInt holeNumber, RegionTable &zmwRegionTable);
+
+    void Close();
+
+private:
+    std::string regionTableFileName;
+    HDFFile regionTableFile;
+    HDFGroup pulseDataGroup;
+    HDF2DArray<int> regions;
+    std::vector<std::string> regionTypes;
+    size_t numRows;
+    // Rows [chunkStart, chunkStart + chunkSize) of the table are in
+    // chunk, of which the first chunkIndex rows have been read.
+    std::vector<int> chunk;
+    size_t chunkStart, chunkSize, chunkIndex;
+    std::vector<RegionAnnotation> zmwRows;
+    UInt zmwHoleNumber;
+    bool hasZmw;
+    RegionAnnotation nextRow;
+    bool hasNextRow;
+    bool isInitialized;
+
+    int OpenTable();
+
+    void Rewind();
+
+    void ReadNextRow();
+};
+
+inline RegionTableStream::RegionTableStream()
+    : numRows(0)
+    , chunkStart(0)
+    , chunkSize(0)
+    , chunkIndex(0)
+    , zmwHoleNumber(0)
+    , hasZmw(false)
+    , hasNextRow(false)
+    , isInitialized(false)
+{
+}
+
+inline RegionTableStream::~RegionTableStream() { Close(); }
+
+inline int RegionTableStream::Initialize(const std::string &regionTableFileNameP)
+{
+    Close();
+    regionTableFileName = regionTableFileNameP;
+    if (OpenTable() == 0) {
+        return 0;
+    }
+    isInitialized = true;
+    chunk.resize(ChunkRows * RegionAnnotation::NCOLS);
+    Rewind();
+    return 1;
+}
+
+inline int RegionTableStream::OpenTable()
+{
+    regionTypes.clear();
+    if (regionTableFile.Open(regionTableFileName, H5F_ACC_RDONLY) == 0 or
+        pulseDataGroup.Initialize(regionTableFile.rootGroup, "PulseData") == 0 or
+        regions.Initialize(pulseDataGroup, "Regions") == 0) {
+        return 0;
+    }
+    HDFAtom<std::vector<std::string> > regionTypesAtom;
+    if (regionTypesAtom.Initialize(regions, "RegionTypes") == 0) {
+        return 0;
+    }
+    regionTypesAtom.Read(regionTypes);
+    numRows = regions.GetNRows();
+    return 1;
+}
+
+inline void RegionTableStream::ReadNextRow()
+{
+    if (chunkIndex == chunkSize) {
+        chunkStart += chunkSize;
+        chunkSize = std::min(ChunkRows, numRows - chunkStart);
+        chunkIndex = 0;
+        if (chunkSize > 0) {
+            regions.Read(chunkStart, chunkStart + chunkSize, 0, RegionAnnotation::NCOLS, &chunk[0]);
+        }
+    }
+    hasNextRow = (chunkIndex < chunkSize);
+    if (hasNextRow) {
+        const int *row = &chunk[chunkIndex * RegionAnnotation::NCOLS];
+        std::copy(row, row + RegionAnnotation::NCOLS, nextRow.row);
+        ++chunkIndex;
+    }
+}
+
+inline void RegionTableStream::Rewind()
+{
+    chunkStart = chunkSize = chunkIndex = 0;
+    hasZmw = false;
+    ReadNextRow();
+}
+
+inline bool RegionTableStream::GetZmwRegions(UInt holeNumber, RegionTable &zmwRegionTable)
+{
+    assert(isInitialized);
+    zmwRegionTable.Reset();
+
+    if (not hasZmw or holeNumber != zmwHoleNumber) {
+        if (hasZmw and holeNumber < zmwHoleNumber) {
+            std::cerr << "WARNING, reads are not sorted by hole number, rescanning region table "
+                      << regionTableFileName << std::endl;
+            Rewind();
+        }
+        zmwRows.clear();
+        while (hasNextRow and UInt(nextRow.GetHoleNumber()) < holeNumber) {
+            ReadNextRow();
+        }
+        while (hasNextRow and UInt(nextRow.GetHoleNumber()) == holeNumber) {
+            zmwRows.push_back(nextRow);
+            ReadNextRow();
+        }
+        zmwHoleNumber = holeNumber;
+        hasZmw = true;
+    }
+    if (zmwRows.empty()) {
+        return false;
+    }
+    zmwRegionTable.ConstructTable(zmwRows, regionTypes);
+    return true;
+}
+
+inline void RegionTableStream::Close()
+{
+    if (isInitialized) {
+        regions.Close();
+        pulseDataGroup.Close();
+        regionTableFile.Close();
+        isInitialized = false;
+    }
+    hasNextRow = false;
+    hasZmw = false;
+    zmwRows.clear();
+}
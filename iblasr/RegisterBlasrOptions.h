@@ -34,6 +34,7 @@ void RegisterBlasrOptions(CommandLineParser& clp, MappingParameters& params)
     clp.RegisterStringOption("-sa", &params.suffixArrayFileName, "");
     clp.RegisterStringOption("-ctab", &params.countTableName, "");
     clp.RegisterStringOption("-regionTable", &params.regionTableFileName, "");
+    clp.RegisterFlagOption("-streamRegionTable", &params.streamRegionTable, "");
     clp.RegisterStringOption("-ccsFofn", &params.ccsFofnFileName, "");
     clp.RegisterIntOption("-bestn", (int*)&params.nBest, "", CommandLineParser::PositiveInteger);
     clp.RegisterIntOption("-limsAlign", &params.limsAlign, "", CommandLineParser::PositiveInteger);
@@ -57,6 +58,7 @@ void RegisterBlasrOptions(CommandLineParser& clp, MappingParameters& params)
     clp.RegisterStringOption("-seqdb", &params.seqDBName, "");
     clp.RegisterStringOption("-anchors", &params.anchorFileName, "");
     clp.RegisterStringOption("-clusters", &params.clusterFileName, "");
+    clp.RegisterFlagOption("-binaryDumps", &params.binaryDumps, "");
     clp.RegisterFlagOption("-samplePaths", (bool*)&params.samplePaths, "");
     clp.RegisterFlagOption("-noStoreMapQV", &params.storeMapQV, "");
     clp.RegisterFlagOption("-nowarp", (bool*)&params.nowarp, "");
@@ -115,6 +117,17 @@ void RegisterBlasrOptions(CommandLineParser& clp, MappingParameters& params)
     clp.RegisterIntOption("-stride", &params.stride, "", CommandLineParser::NonNegativeInteger);
     clp.RegisterFloatOption("-subsample", &params.subsample, "", CommandLineParser::PositiveFloat);
     clp.RegisterIntOption("-nproc", &params.nProc, "", CommandLineParser::PositiveInteger);
+    clp.RegisterIntOption("-prefetch", &params.prefetchReads, "",
+                          CommandLineParser::NonNegativeInteger);
+    clp.RegisterIntOption("-progress", &params.progressInterval, "",
+                          CommandLineParser::NonNegativeInteger);
+    clp.RegisterStringOption("-stageStats", &params.stageStatsFileName, "");
+    clp.RegisterIntOption("-intraReadThreads", &params.intraReadThreads, "",
+                          CommandLineParser::NonNegativeInteger);
+    clp.RegisterIntOption("-intraReadMinLength", &params.intraReadMinLength, "",
+                          CommandLineParser::NonNegativeInteger);
+    clp.RegisterIntOption("-intraReadIdleCores", &params.intraReadIdleCores, "",
+                          CommandLineParser::NonNegativeInteger);
     clp.RegisterFlagOption("-sortRefinedAlignments", (bool*)&params.sortRefinedAlignments, "");
     clp.RegisterIntOption("-quallc", &params.qualityLowerCaseThreshold, "",
                           CommandLineParser::Integer);
@@ -271,6 +284,13 @@ const std::string BlasrHelp(MappingParameters& params)
         << "               or a fofn.  When a region table is specified, any region table inside "
         << std::endl
         << "               the reads.plx.h5 or reads.bax.h5 files are ignored." << std::endl
+        << "   --streamRegionTable" << std::endl
+        << "               Read the region table along with the reads, one zmw at a time, "
+        << std::endl
+        << "               instead of loading all of it before aligning." << std::endl
+        << "               Region tables only come with the bax.h5 and plx.h5 formats, "
+        << std::endl
+        << "               which are deprecated; BAM input does not use this option." << std::endl
         << std::endl
 
         << " Options for modifying reads." << std::endl
@@ -587,6 +607,55 @@ const std::string BlasrHelp(MappingParameters& params)
            "array and "
         << std::endl
         << "               tuple count table are shared." << std::endl
+        << "   --prefetch N (0)" << std::endl
+        << "               Decode BAM and dataset reads on a separate thread, keeping up to N "
+           "reads"
+        << std::endl
+        << "               (zmws with --concordant) ready for the aligning threads.  0 disables "
+        << std::endl
+        << "               prefetching." << std::endl
+        << "   --progress S (0)" << std::endl
+        << "               Every S seconds print the reads/sec and bases/sec aligned so far, and "
+           "the share"
+        << std::endl
+        << "               of time threads spent waiting to read and write, to stderr.  0 "
+           "disables this."
+        << std::endl
+        << "   --stageStats file" << std::endl
+        << "               Write per-thread read, base and byte counts, and time and latency "
+           "quantiles"
+        << std::endl
+        << "               of each mapping stage (reader wait, seeding, chaining, sdp, "
+           "refinement,"
+        << std::endl
+        << "               concordant, writer wait) to file.  Rewritten every --progress "
+           "seconds."
+        << std::endl
+        << "   --intraReadThreads N (0)" << std::endl
+        << "               Map reads of at least --intraReadMinLength bases with up to N more "
+           "threads,"
+        << std::endl
+        << "               seeding the two strands and aligning candidates at the same time.  "
+           "Threads"
+        << std::endl
+        << "               are only used when cores are idle, i.e. beyond --nproc, or once other "
+           "aligning"
+        << std::endl
+        << "               threads run out of reads.  0 disables this." << std::endl
+        << "   --intraReadMinLength L (50000)" << std::endl
+        << "               Minimum read length to map with --intraReadThreads." << std::endl
+        << "   --intraReadIdleCores N" << std::endl
+        << "               Number of idle cores to start with, instead of the online cores beyond "
+           "--nproc."
+        << std::endl
+        << "   --binaryDumps" << std::endl
+        << "               Write the --anchors and --clusters files in a compact binary format "
+           "that"
+        << std::endl
+        << "               aligning threads buffer without waiting on each other.  Print them "
+           "as text"
+        << std::endl
+        << "               with blasrDumpDecode." << std::endl
         << "   --start S (0)" << std::endl
         << "               Index of the first read to begin aligning. This is useful when multiple "
            "instances "
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <pbdata/Types.h>
+#include <alignment/algorithms/alignment/DistanceMatrixScoreFunction.hpp>
+#include <pbdata/NucConversion.hpp>
+
+//
+// A DistanceMatrixScoreFunction for score matrices with one score for
+// all matches and one for all mismatches of A, C, G and T, which is
+// what the default matrix with -match and -mismatch looks like.  The
+// two scores are members, so a kernel instantiated with this function
+// keeps them in registers instead of indexing the 5x5 matrix for every
+// cell.  Pairs with an N are scored by the matrix as before.  Kernels
+// are instantiated for both functions, and
+// DispatchDistanceScoreFunction picks one per alignment.
+//
+template <typename T_RefSequence, typename T_QuerySequence>
+class UniformDistanceScoreFunction
+    : public DistanceMatrixScoreFunction<T_RefSequence, T_QuerySequence>
+{
+public:
+    typedef DistanceMatrixScoreFunction<T_RefSequence, T_QuerySequence> Base;
+
+    // Copy the gap costs and options of scoreFn, which scores with
+    // scoreMatrix.
+    UniformDistanceScoreFunction(const Base &scoreFn, int scoreMatrix[5][5]);
+
+    // True if the matrix has a single match and a single mismatch
+    // score, so that this scores every cell as the matrix does.
+    bool IsUniform() const { return isUniform; }
+
+    using Base::Match;
+
+    int Match(T_RefSequence &ref, DNALength refPos, T_QuerySequence &query, DNALength queryPos);
+
+private:
+    int matchScore;
+    int mismatchScore;
+    bool isUniform;
+};
+
+template <typename T_RefSequence, typename T_QuerySequence>
+UniformDistanceScoreFunction<T_RefSequence, T_QuerySequence>::UniformDistanceScoreFunction(
+    const Base &scoreFn, int scoreMatrix[5][5])
+    : Base(scoreFn)
+    , matchScore(scoreMatrix[0][0])
+    , mismatchScore(scoreMatrix[0][1])
+    , isUniform(true)
+{
+    for (int a = 0; a < 4; a++) {
+        for (int b = 0; b < 4; b++) {
+            if (scoreMatrix[a][b] != ((a == b) ? matchScore : mismatchScore)) {
+                isUniform = false;
+            }
+        }
+    }
+}
+
+template <typename T_RefSequence, typename T_QuerySequence>
+inline int UniformDistanceScoreFunction<T_RefSequence, T_QuerySequence>::Match(
+    T_RefSequence &ref, DNALength refPos, T_QuerySequence &query, DNALength queryPos)
+{
+    int r = ThreeBit[ref.seq[refPos]];
+    int q = ThreeBit[query.seq[queryPos]];
+    if (r < 4 and q < 4) {
+        return (r == q) ? matchScore : mismatchScore;
+    }
+    return Base::Match(ref, refPos, query, queryPos);
+}
+
+//
+// Run kernel, a callable taking a score function, with uniformScoreFn
+// when it applies and distScoreFn otherwise.
+//
+template <typename T_RefSequence, typename T_QuerySequence, typename T_Kernel>
+auto DispatchDistanceScoreFunction(
+    UniformDistanceScoreFunction<T_RefSequence, T_QuerySequence> &uniformScoreFn,
+    DistanceMatrixScoreFunction<T_RefSequence, T_QuerySequence> &distScoreFn, T_Kernel kernel)
+    -> decltype(kernel(distScoreFn))
+{
+    if (uniformScoreFn.IsUniform()) {
+        return kernel(uniformScoreFn);
+    }
+    return kernel(distScoreFn);
+}
@@ -0,0 +1,63 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "../iblasr/DebugDump.hpp"
+
+void PrintUsage()
+{
+    std::cout << "usage: blasrDumpDecode dump_file" << std::endl
+              << "Print an anchor or cluster file written by blasr -binaryDumps as text."
+              << std::endl
+              << "Anchors are printed as the read title, followed by one 'q t l' line per anchor."
+              << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        PrintUsage();
+        std::exit(EXIT_FAILURE);
+    }
+    std::string dumpFileName = argv[1];
+    std::ifstream dumpIn(dumpFileName.c_str(), std::ios::in | std::ios::binary);
+    if (not dumpIn.good()) {
+        std::cout << "ERROR, could not open " << dumpFileName << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    DebugDumpReader reader(dumpIn);
+    if (not reader.ReadHeader()) {
+        std::cout << "ERROR, " << dumpFileName << " is not a blasr binary dump." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (reader.dumpType == DebugDump::ClusterRecord) {
+        std::cout << "total_size p_value n_anchors read_length align_score read_accuracy "
+                     "anchor_probability min_exp_anchors seq_length"
+                  << std::endl;
+    }
+    while (reader.Next()) {
+        if (reader.type == DebugDump::AnchorRecord) {
+            std::cout << reader.title;
+            if (reader.strand == 1) {
+                std::cout << " (RC) ";
+            }
+            std::cout << std::endl;
+            for (size_t i = 0; i < reader.anchors.size(); i++) {
+                std::cout << reader.anchors[i].q << " " << reader.anchors[i].t << " "
+                          << reader.anchors[i].l << std::endl;
+            }
+        } else {
+            std::cout << reader.totalSize << " " << reader.pValue << " " << reader.nAnchors << " "
+                      << reader.readLength << " " << reader.score << " " << reader.pctSimilarity
+                      << " "
+                      << " " << reader.minExpAnchors << " " << reader.alignedLength << std::endl;
+        }
+    }
+    if (reader.Corrupt()) {
+        std::cout << "ERROR, " << dumpFileName << " is truncated or corrupt." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return 0;
+}
@@ -1,5 +1,7 @@
 #define __FAST_MATH__
 
+#include <pthread.h>
+
 #include <algorithm>
 #include <cassert>
 #include <cstdio>
@@ -1002,14 +1004,16 @@ void ClearCachedFields(BaseFile &baseFile, PulseFile &pulseFile, HDFBasReader &h
 }
 
 // Compute StartFrame from BaseCalls only.
+// preBaseFramesIncluded is whether the bas reader includes
+// PreBaseFrames, found before any thread starts since looking it up in
+// HDFBasReader::includedFields is not safe from several threads.
 // Return true if succeed, false otherwise.
-bool ComputeStartFrameFromBase(BaseFile &baseFile, HDFBasReader &hdfBasReader,
+bool ComputeStartFrameFromBase(BaseFile &baseFile, const bool &preBaseFramesIncluded,
                                const bool &useBaseFile, MovieAlnIndexLookupTable &lookupTable,
                                std::vector<UInt> &newStartFrame)
 {
     newStartFrame.resize(lookupTable.readLength);
-    if (useBaseFile and hdfBasReader.FieldIsIncluded("PreBaseFrames") and
-        hdfBasReader.includedFields["PreBaseFrames"] and baseFile.preBaseFrames.size() > 0) {
+    if (useBaseFile and preBaseFramesIncluded and baseFile.preBaseFrames.size() > 0) {
         // baseFile.preBaseFrame data type = uint16
         // startFrame data type = uint32
         for (int i = 0; i < lookupTable.readLength; i++) {
@@ -1043,23 +1047,129 @@ bool ComputeStartFrameFromPulse(PulseFile &pulseFile, HDFPlsReader &hdfPlsReader
     return false;
 }
 
+//
+// The fields of an alignment that are copied out of the pls file.  They
+// are read on the thread that owns hdfPlsReader, since neither the
+// reader nor HDF5 may be used from several threads, and the metric is
+// then computed from them on any thread.
+//
+class PulseFieldsForAlignment
+{
+public:
+    std::vector<int> baseToPulseIndexMap;
+    // StartFrame of the whole read, and whether it came from the pls file.
+    bool hasStartFrame;
+    std::vector<UInt> startFrame;
+    // WidthInFrames of the whole read for IPD, else of the aligned bases.
+    std::vector<uint16_t> widthInFrames;
+    std::vector<float> classifierQV;
+    std::vector<HalfWord> midSignal;
+    std::vector<uint16_t> meanSignal;
+};
+
+//
+// Copy the pls fields that curMetric needs for one alignment.
+//
+void ReadPulseFieldsForAlignment(BaseFile &baseFile, PulseFile &pulseFile,
+                                 HDFPlsReader &hdfPlsReader, const bool &usePulseFile,
+                                 MovieAlnIndexLookupTable &lookupTable,
+                                 const std::string &curMetric, PulseFieldsForAlignment &fields)
+{
+    const UInt ungappedAlignedSequenceLength = lookupTable.queryEnd - lookupTable.queryStart;
+    const UInt &plsReadIndex = lookupTable.plsReadIndex;
+    const UInt &readStart = lookupTable.readStart;
+    const UInt &readLength = lookupTable.readLength;
+    const UInt &queryStart = lookupTable.queryStart;
+    (void)(readStart);
+
+    std::vector<int> &baseToPulseIndexMap = fields.baseToPulseIndexMap;
+    baseToPulseIndexMap.clear();
+    fields.hasStartFrame = false;
+    if (usePulseFile && IsPulseMetric(curMetric)) {
+        // Map bases in the read to pulse indices.
+        MapBaseToPulseIndex(baseFile, pulseFile, lookupTable, baseToPulseIndexMap);
+    }
+
+    if (curMetric == "ClassifierQV") {
+        assert(pulseFile.classifierQV.size() > 0 &&
+               pulseFile.classifierQV.size() >= readStart + readLength);
+        // For the data used for this table, it is possible to simply
+        // reference the data for the bas file,  but for the pls file,
+        // it is necessary to copy since there is a packing of data.
+        fields.classifierQV.resize(ungappedAlignedSequenceLength);
+        hdfPlsReader.CopyFieldAt(pulseFile, "ClassifierQV", plsReadIndex,
+                                 &baseToPulseIndexMap[queryStart], &fields.classifierQV[0],
+                                 ungappedAlignedSequenceLength);
+
+    } else if (curMetric == "StartFrame" || curMetric == "StartFramePulse") {
+        fields.hasStartFrame =
+            ComputeStartFrameFromPulse(pulseFile, hdfPlsReader, usePulseFile, lookupTable,
+                                       baseToPulseIndexMap, fields.startFrame);
+
+    } else if (curMetric == "WidthInFrames" || curMetric == "PulseWidth") {
+        if (usePulseFile) {
+            fields.widthInFrames.resize(ungappedAlignedSequenceLength);
+            hdfPlsReader.CopyFieldAt(pulseFile, "WidthInFrames", plsReadIndex,
+                                     &baseToPulseIndexMap[queryStart], &fields.widthInFrames[0],
+                                     ungappedAlignedSequenceLength);
+        }
+
+    } else if (curMetric == "pkmid") {
+        assert(usePulseFile);
+        std::string ungappedAlignedSequence = lookupTable.alignedSequence;
+        RemoveGaps(ungappedAlignedSequence, ungappedAlignedSequence);
+        fields.midSignal.resize(ungappedAlignedSequenceLength);
+        hdfPlsReader.CopyFieldAt(pulseFile, "MidSignal", plsReadIndex,
+                                 &baseToPulseIndexMap[queryStart], &fields.midSignal[0],
+                                 ungappedAlignedSequenceLength, ungappedAlignedSequence);
+
+    } else if (curMetric == "IPD") {
+        if (usePulseFile) {
+            // Need to read StartFrame & WidthInFrames for the entire read,
+            // not only for a subset of bases in the alignment
+            assert(pulseFile.startFrame.size() > 0);
+            assert(pulseFile.plsWidthInFrames.size() > 0);
+            fields.startFrame.resize(readLength);
+            hdfPlsReader.CopyFieldAt(pulseFile, "StartFrame", plsReadIndex, &baseToPulseIndexMap[0],
+                                     &fields.startFrame[0], readLength);
+            fields.hasStartFrame = true;
+            fields.widthInFrames.resize(readLength);
+            hdfPlsReader.CopyFieldAt(pulseFile, "WidthInFrames", plsReadIndex,
+                                     &baseToPulseIndexMap[0], &fields.widthInFrames[0], readLength);
+        }
+
+    } else if (curMetric == "Light") {
+        assert(usePulseFile);
+        std::string ungappedAlignedSequence = lookupTable.alignedSequence;
+        RemoveGaps(ungappedAlignedSequence, ungappedAlignedSequence);
+        fields.meanSignal.resize(ungappedAlignedSequenceLength);
+        hdfPlsReader.CopyFieldAt(pulseFile, "MeanSignal", plsReadIndex,
+                                 &baseToPulseIndexMap[queryStart], &fields.meanSignal[0],
+                                 ungappedAlignedSequenceLength, ungappedAlignedSequence);
+        fields.widthInFrames.resize(ungappedAlignedSequenceLength);
+        hdfPlsReader.CopyFieldAt(pulseFile, "WidthInFrames", plsReadIndex,
+                                 &baseToPulseIndexMap[queryStart], &fields.widthInFrames[0],
+                                 ungappedAlignedSequenceLength);
+    }
+}
+
 // Compute StartFrame from either (1) BaseCalls or (2) PulseCalls.
 //    (1) Uses baseFile.preBaseFrames and baseFile.basWidthInFrames
-//    (2) Uses pulseFile.startFrame
+//    (2) Uses pulseFile.startFrame, read into pulseFields
 // In theory, the generated results using both methods should
 // be exactly the same. However, they can be different in practice
 // because PreBaseFrames is of data type uint_16, while its
 // value can exceed maximum uint_16 (65535).
 // When possible, always use PulseCalls.
-void ComputeStartFrame(BaseFile &baseFile, PulseFile &pulseFile, HDFBasReader &hdfBasReader,
-                       HDFPlsReader &hdfPlsReader, bool useBaseFile, bool usePulseFile,
-                       MovieAlnIndexLookupTable &lookupTable, std::vector<int> &baseToPulseIndexMap,
-                       std::vector<UInt> &newStartFrame)
+void ComputeStartFrame(BaseFile &baseFile, const bool &preBaseFramesIncluded,
+                       const PulseFieldsForAlignment &pulseFields, bool useBaseFile,
+                       MovieAlnIndexLookupTable &lookupTable, std::vector<UInt> &newStartFrame)
 {
 
-    if (!ComputeStartFrameFromPulse(pulseFile, hdfPlsReader, usePulseFile, lookupTable,
-                                    baseToPulseIndexMap, newStartFrame)) {
-        if (!ComputeStartFrameFromBase(baseFile, hdfBasReader, useBaseFile, lookupTable,
+    if (pulseFields.hasStartFrame) {
+        newStartFrame = pulseFields.startFrame;
+    } else {
+        if (!ComputeStartFrameFromBase(baseFile, preBaseFramesIncluded, useBaseFile, lookupTable,
                                        newStartFrame)) {
             std::cout << "ERROR! There is insufficient data to compute metric: StartFrame."
                       << std::endl;
@@ -1068,6 +1178,324 @@ void ComputeStartFrame(BaseFile &baseFile, PulseFile &pulseFile, HDFBasReader &h
     }
 }
 
+//
+// Compute a metric for a single alignment into the array of the metric,
+// at the offsets of the alignment.  Assume that all required fields
+// have been loaded, and that the pls fields of the alignment are in
+// pulseFields.  Alignments write disjoint parts of the array and only
+// read the cached fields, so several can be computed at once.
+//
+void ComputeMetricForAlignment(BaseFile &baseFile, const bool &preBaseFramesIncluded,
+                               const PulseFieldsForAlignment &pulseFields, const bool &useBaseFile,
+                               const bool &usePulseFile, MovieAlnIndexLookupTable &lookupTable,
+                               UInt alnArrayLength, const std::string &curMetric,
+                               std::vector<UInt> &pulseMetric, std::vector<UChar> &qvMetric,
+                               std::vector<HalfWord> &frameRateMetric,
+                               std::vector<UInt> &timeMetric, std::vector<char> &tagMetric,
+                               std::vector<float> &floatMetric)
+{
+    (void)(alnArrayLength);
+
+    const UInt alignedSequenceLength = lookupTable.offsetEnd - lookupTable.offsetBegin;
+    const UInt ungappedAlignedSequenceLength = lookupTable.queryEnd - lookupTable.queryStart;
+    const UInt &readStart = lookupTable.readStart;
+    const UInt &readLength = lookupTable.readLength;
+    const UInt &queryStart = lookupTable.queryStart;
+    const UInt &offsetBegin = lookupTable.offsetBegin;
+    const UInt &offsetEnd = lookupTable.offsetEnd;
+    assert(offsetEnd <= alnArrayLength);
+    assert(offsetBegin + alignedSequenceLength <= alnArrayLength);
+
+    std::vector<int> baseToAlignmentMap;
+    // Map bases in the aligned sequence to their positions in the alignment.
+    CreateSequenceToAlignmentMap(lookupTable.alignedSequence, baseToAlignmentMap);
+
+    UInt i;
+    if (curMetric == "QualityValue") {
+        assert(baseFile.qualityValues.size() > 0 &&
+               baseFile.qualityValues.size() >= readStart + readLength);
+        std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            // cap quality value
+            qvMetric[offsetBegin + baseToAlignmentMap[i]] =
+                std::min(maxQualityValue, baseFile.qualityValues[readStart + queryStart + i]);
+        }
+        qvMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "InsertionQV") {
+        assert(baseFile.insertionQV.size() > 0 &&
+               baseFile.insertionQV.size() >= readStart + readLength);
+        std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            // cap quality value
+            qvMetric[offsetBegin + baseToAlignmentMap[i]] =
+                std::min(maxQualityValue, baseFile.insertionQV[readStart + queryStart + i]);
+        }
+        qvMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "MergeQV") {
+        assert(baseFile.mergeQV.size() > 0 && baseFile.mergeQV.size() >= readStart + readLength);
+        std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            // cap quality value
+            qvMetric[offsetBegin + baseToAlignmentMap[i]] =
+                std::min(maxQualityValue, baseFile.mergeQV[readStart + queryStart + i]);
+        }
+        qvMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "DeletionQV") {
+        assert(baseFile.deletionQV.size() > 0 &&
+               baseFile.deletionQV.size() >= readStart + readLength);
+        std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            // cap quality value
+            qvMetric[offsetBegin + baseToAlignmentMap[i]] =
+                std::min(maxQualityValue, baseFile.deletionQV[readStart + queryStart + i]);
+        }
+        qvMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "DeletionTag") {
+        assert(baseFile.deletionTag.size() > 0 &&
+               baseFile.deletionTag.size() >= readStart + readLength);
+        std::fill(&tagMetric[offsetBegin], &tagMetric[offsetEnd], '-');
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            assert(offsetBegin + baseToAlignmentMap[i] < tagMetric.size());
+            tagMetric[offsetBegin + baseToAlignmentMap[i]] =
+                baseFile.deletionTag[readStart + queryStart + i];
+        }
+        tagMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "PulseIndex") {
+        assert(baseFile.pulseIndex.size() > 0 &&
+               baseFile.pulseIndex.size() >= readStart + readLength);
+        std::fill(&pulseMetric[offsetBegin], &pulseMetric[offsetEnd], 0);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            pulseMetric[offsetBegin + baseToAlignmentMap[i]] =
+                baseFile.pulseIndex[readStart + queryStart + i];
+        }
+        pulseMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "SubstitutionTag") {
+        assert(baseFile.substitutionTag.size() > 0 &&
+               baseFile.substitutionTag.size() >= readStart + readLength);
+        std::fill(&tagMetric[offsetBegin], &tagMetric[offsetEnd], '-');
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            tagMetric[offsetBegin + baseToAlignmentMap[i]] =
+                baseFile.substitutionTag[readStart + queryStart + i];
+        }
+        tagMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "SubstitutionQV") {
+        assert(baseFile.substitutionQV.size() > 0 &&
+               baseFile.substitutionQV.size() >= readStart + readLength);
+        std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            qvMetric[offsetBegin + baseToAlignmentMap[i]] =
+                std::min(maxQualityValue, baseFile.substitutionQV[readStart + queryStart + i]);
+        }
+        qvMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "ClassifierQV") {
+        const std::vector<float> &newClassifierQV = pulseFields.classifierQV;
+        std::fill(&floatMetric[offsetBegin], &floatMetric[offsetEnd], NaN);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            floatMetric[offsetBegin + baseToAlignmentMap[i]] = newClassifierQV[i];
+        }
+        floatMetric[offsetBegin + alignedSequenceLength] = 0;
+
+        /*            } else if (curMetric == "StartTimeOffset") {
+        // StartTimeOffset is a subset of StartFrame.
+        std::vector<UInt> newStartFrame;
+        ComputeStartFrame(baseFile, preBaseFramesIncluded, pulseFields,
+                          useBaseFile, lookupTable, newStartFrame);
+
+        startTimeOffsetMetric[offsetBegin] = newStartFrame[queryStart];
+*/
+    } else if (curMetric == "StartFrame") {
+        std::vector<UInt> newStartFrame;
+        ComputeStartFrame(baseFile, preBaseFramesIncluded, pulseFields, useBaseFile, lookupTable,
+                          newStartFrame);
+        std::fill(&timeMetric[offsetBegin], &timeMetric[offsetEnd], missingPulseIndex);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            timeMetric[offsetBegin + baseToAlignmentMap[i]] = newStartFrame[queryStart + i];
+        }
+        timeMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "StartFrameBase") {
+        // Sneaky metric, compute StartFrame from BaseCalls only.
+        std::vector<UInt> newStartFrame;
+        ComputeStartFrameFromBase(baseFile, preBaseFramesIncluded, useBaseFile, lookupTable,
+                                  newStartFrame);
+        std::fill(&timeMetric[offsetBegin], &timeMetric[offsetEnd], missingPulseIndex);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            timeMetric[offsetBegin + baseToAlignmentMap[i]] = newStartFrame[queryStart + i];
+        }
+        timeMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "StartFramePulse") {
+        // Sneaky metric, compute StartFrame from PulseCalls only.
+        const std::vector<UInt> &newStartFrame = pulseFields.startFrame;
+        std::fill(&timeMetric[offsetBegin], &timeMetric[offsetEnd], missingPulseIndex);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            timeMetric[offsetBegin + baseToAlignmentMap[i]] = newStartFrame[queryStart + i];
+        }
+        timeMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "PreBaseFrames") {
+        // Directly load baseFile.PreBaseFrames.
+        // DON'T compute it from PulseCalls even if you can.
+        assert(baseFile.preBaseFrames.size() > 0 &&
+               baseFile.preBaseFrames.size() >= readStart + readLength);
+        std::fill(&frameRateMetric[offsetBegin], &frameRateMetric[offsetEnd],
+                  missingFrameRateValue);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            frameRateMetric[offsetBegin + baseToAlignmentMap[i]] =
+                baseFile.preBaseFrames[readStart + queryStart + i];
+        }
+        frameRateMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "WidthInFrames" || curMetric == "PulseWidth") {
+        // For legacy reasons, it's possible the width in frames is
+        // stored in the bas file. If this is the case, use the width
+        // in frames there.  Otherwise, use the width in frames stored
+        // in the pls file.
+        std::vector<uint16_t> newWidthInFrames;
+        newWidthInFrames.resize(ungappedAlignedSequenceLength);
+        if (usePulseFile) {
+            newWidthInFrames = pulseFields.widthInFrames;
+        } else if (useBaseFile) {
+            // basWidthInFrames data type uint16
+            std::copy(
+                &baseFile.basWidthInFrames[readStart + queryStart],
+                &baseFile.basWidthInFrames[readStart + queryStart + ungappedAlignedSequenceLength],
+                &newWidthInFrames[0]);
+        }
+
+        std::fill(&frameRateMetric[offsetBegin], &frameRateMetric[offsetEnd],
+                  missingFrameRateValue);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            frameRateMetric[offsetBegin + baseToAlignmentMap[i]] = newWidthInFrames[i];
+        }
+        frameRateMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "pkmid") {
+        // pkmid in cmp.h5 is MidSignal in pls.h5, but
+        // data type of MidSignal is uint16 in pls files,
+        // data type of pkmid is float in cmp files.
+        assert(usePulseFile);
+        const std::vector<HalfWord> &newMidSignal = pulseFields.midSignal;
+
+        std::fill(&floatMetric[offsetBegin], &floatMetric[offsetEnd], NaN);
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            floatMetric[offsetBegin + baseToAlignmentMap[i]] = newMidSignal[i];
+        }
+        floatMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "IPD") {
+        std::fill(&frameRateMetric[offsetBegin], &frameRateMetric[offsetEnd],
+                  missingFrameRateValue);
+
+        // IPD can be either (1) copied from baseFile.preBaseFrames
+        // or (2) computed from pulseFile.StartFrame and pulseFile.WidthInFrames
+        // Always use method (2) when possible as it is more accurate.
+        if (usePulseFile) {
+            // StartFrame & WidthInFrames of the entire read.
+            const std::vector<UInt> &newStartFrame = pulseFields.startFrame;
+            const std::vector<uint16_t> &newWidthInFrames = pulseFields.widthInFrames;
+
+            for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+                // The IPD is undefined for the first base in a read.
+                if (queryStart == 0 and i == 0) {
+                    frameRateMetric[offsetBegin + baseToAlignmentMap[i]] = 0;
+                } else {
+                    frameRateMetric[offsetBegin + baseToAlignmentMap[i]] =
+                        newStartFrame[queryStart + i] - newStartFrame[i + queryStart - 1] -
+                        newWidthInFrames[i + queryStart - 1];
+                }
+            }
+        } else if (useBaseFile) {
+            assert(baseFile.preBaseFrames.size() > 0);
+            assert(baseFile.preBaseFrames.size() >= readStart + readLength);
+
+            for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+                frameRateMetric[offsetBegin + baseToAlignmentMap[i]] =
+                    baseFile.preBaseFrames[readStart + queryStart + i];
+            }
+        }
+        frameRateMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else if (curMetric == "Light") {
+        // Light can be computed from pulseFile.meanSignal and
+        // pulseFile.plsWidthInFrames. Might have been deprecated.
+        assert(usePulseFile);
+        std::fill(&frameRateMetric[offsetBegin], &frameRateMetric[offsetEnd],
+                  missingFrameRateValue);
+
+        const std::vector<uint16_t> &newMeanSignal = pulseFields.meanSignal;
+        const std::vector<uint16_t> &newWidthInFrames = pulseFields.widthInFrames;
+
+        for (i = 0; i < ungappedAlignedSequenceLength; i++) {
+            frameRateMetric[offsetBegin + baseToAlignmentMap[i]] =
+                newMeanSignal[i] * newWidthInFrames[i];
+        }
+        frameRateMetric[offsetBegin + alignedSequenceLength] = 0;
+
+    } else {
+        std::cout << "ERROR, unknown metric " << curMetric << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+//
+// A block of alignments whose metric one thread of WriteMetric computes.
+//
+class MetricThreadArgs
+{
+public:
+    BaseFile *baseFile;
+    // The pls fields of alignment firstIndex + i are pulseFields[i].
+    std::vector<PulseFieldsForAlignment> *pulseFields;
+    bool preBaseFramesIncluded;
+    bool useBaseFile, usePulseFile;
+    std::vector<MovieAlnIndexLookupTable> *lookupTables;
+    UInt alnArrayLength;
+    const std::string *curMetric;
+    std::vector<UInt> *pulseMetric;
+    std::vector<UChar> *qvMetric;
+    std::vector<HalfWord> *frameRateMetric;
+    std::vector<UInt> *timeMetric;
+    std::vector<char> *tagMetric;
+    std::vector<float> *floatMetric;
+    // Alignments firstIndex ... lastIndex are dealt to the threads in
+    // blocks of BlockSize, round robin.  The pls fields are read for
+    // ChunkBlocks blocks per thread at a time.
+    static const size_t BlockSize = 64;
+    static const size_t ChunkBlocks = 16;
+    size_t firstIndex, lastIndex;
+    int threadIndex, numThreads;
+};
+
+void *ComputeMetricForAlignmentBlocks(void *argsP)
+{
+    MetricThreadArgs &args = *static_cast<MetricThreadArgs *>(argsP);
+    for (size_t blockBegin = args.firstIndex + args.threadIndex * MetricThreadArgs::BlockSize;
+         blockBegin < args.lastIndex; blockBegin += args.numThreads * MetricThreadArgs::BlockSize) {
+        size_t blockEnd = std::min(blockBegin + MetricThreadArgs::BlockSize, args.lastIndex);
+        for (size_t movieAlignmentIndex = blockBegin; movieAlignmentIndex < blockEnd;
+             movieAlignmentIndex++) {
+            MovieAlnIndexLookupTable &lookupTable = (*args.lookupTables)[movieAlignmentIndex];
+            if (lookupTable.skip) continue;
+            ComputeMetricForAlignment(*args.baseFile, args.preBaseFramesIncluded,
+                                      (*args.pulseFields)[movieAlignmentIndex - args.firstIndex],
+                                      args.useBaseFile, args.usePulseFile, lookupTable,
+                                      args.alnArrayLength, *args.curMetric, *args.pulseMetric,
+                                      *args.qvMetric, *args.frameRateMetric, *args.timeMetric,
+                                      *args.tagMetric, *args.floatMetric);
+        }
+    }
+    return NULL;
+}
+
 //
 // Compute and write an entire metric to cmp.h5.
 // Assume that all required fields have been loaded.
@@ -1078,12 +1506,17 @@ void WriteMetric(CmpFile &cmpFile, BaseFile &baseFile, PulseFile &pulseFile,
                  const bool &useBaseFile, const bool &usePulseFile, const bool &useCcsOnly,
                  std::vector<MovieAlnIndexLookupTable> &lookupTables,
                  std::vector<std::pair<UInt, UInt> > &groupedLookupTablesIndexPairs,
-                 const std::string &curMetric)
+                 const std::string &curMetric, int numThreads)
 {
     (void)(cmpFile);
     (void)(hdfCcsReader);
     (void)(useCcsOnly);
 
+    // Look fields up here, as includedFields is not safe to read from
+    // the threads below.
+    bool preBaseFramesIncluded = hdfBasReader.FieldIsIncluded("PreBaseFrames") and
+                                 hdfBasReader.includedFields["PreBaseFrames"];
+
     for (size_t index = 0; index < groupedLookupTablesIndexPairs.size(); index++) {
         // Group[index] contains all items in lookupTables[firstIndex...lastIndex)
         UInt firstIndex = groupedLookupTablesIndexPairs[index].first;
@@ -1207,311 +1640,63 @@ void WriteMetric(CmpFile &cmpFile, BaseFile &baseFile, PulseFile &pulseFile,
             std::exit(EXIT_FAILURE);
         }
 
-        for (size_t movieAlignmentIndex = firstIndex; movieAlignmentIndex < lastIndex;
-             movieAlignmentIndex++) {
-            MovieAlnIndexLookupTable &lookupTable = lookupTables[movieAlignmentIndex];
-            if (lookupTable.skip) continue;
-
-            const UInt alignedSequenceLength = lookupTable.offsetEnd - lookupTable.offsetBegin;
-            const UInt ungappedAlignedSequenceLength =
-                lookupTable.queryEnd - lookupTable.queryStart;
-            const UInt &plsReadIndex = lookupTable.plsReadIndex;
-            const UInt &readStart = lookupTable.readStart;
-            const UInt &readLength = lookupTable.readLength;
-            const UInt &queryStart = lookupTable.queryStart;
-            const UInt &offsetBegin = lookupTable.offsetBegin;
-            const UInt &offsetEnd = lookupTable.offsetEnd;
-            assert(offsetEnd <= alnArrayLength);
-            assert(offsetBegin + alignedSequenceLength <= alnArrayLength);
-
-            // Condense gaps and get ungapped aligned sequence.
-            std::string ungappedAlignedSequence = lookupTable.alignedSequence;
-            RemoveGaps(ungappedAlignedSequence, ungappedAlignedSequence);
-
-            std::vector<int> baseToAlignmentMap;
-            // Map bases in the aligned sequence to their positions in the alignment.
-            CreateSequenceToAlignmentMap(lookupTable.alignedSequence, baseToAlignmentMap);
-
-            std::vector<int> baseToPulseIndexMap;
-            if (usePulseFile && IsPulseMetric(curMetric)) {
-                // Map bases in the read to pulse indices.
-                MapBaseToPulseIndex(baseFile, pulseFile, lookupTable, baseToPulseIndexMap);
+        //
+        // Compute the metric for all alignments of the group on
+        // numThreads threads, a chunk of alignments at a time.  The pls
+        // fields of a chunk are read here first, since HDF5 is only
+        // used from this thread.
+        //
+        size_t chunkSize = numThreads * MetricThreadArgs::ChunkBlocks * MetricThreadArgs::BlockSize;
+        std::vector<PulseFieldsForAlignment> pulseFields(
+            std::min<size_t>(chunkSize, lastIndex - firstIndex));
+        for (size_t chunkBegin = firstIndex; chunkBegin < lastIndex; chunkBegin += chunkSize) {
+            size_t chunkEnd = std::min<size_t>(chunkBegin + chunkSize, lastIndex);
+            for (size_t movieAlignmentIndex = chunkBegin; movieAlignmentIndex < chunkEnd;
+                 movieAlignmentIndex++) {
+                MovieAlnIndexLookupTable &lookupTable = lookupTables[movieAlignmentIndex];
+                if (lookupTable.skip) continue;
+                ReadPulseFieldsForAlignment(baseFile, pulseFile, hdfPlsReader, usePulseFile,
+                                            lookupTable, curMetric,
+                                            pulseFields[movieAlignmentIndex - chunkBegin]);
             }
 
-            UInt i;
-            if (curMetric == "QualityValue") {
-                assert(baseFile.qualityValues.size() > 0 &&
-                       baseFile.qualityValues.size() >= readStart + readLength);
-                std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    // cap quality value
-                    qvMetric[offsetBegin + baseToAlignmentMap[i]] = std::min(
-                        maxQualityValue, baseFile.qualityValues[readStart + queryStart + i]);
-                }
-                qvMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "InsertionQV") {
-                assert(baseFile.insertionQV.size() > 0 &&
-                       baseFile.insertionQV.size() >= readStart + readLength);
-                std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    // cap quality value
-                    qvMetric[offsetBegin + baseToAlignmentMap[i]] =
-                        std::min(maxQualityValue, baseFile.insertionQV[readStart + queryStart + i]);
-                }
-                qvMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "MergeQV") {
-                assert(baseFile.mergeQV.size() > 0 &&
-                       baseFile.mergeQV.size() >= readStart + readLength);
-                std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    // cap quality value
-                    qvMetric[offsetBegin + baseToAlignmentMap[i]] =
-                        std::min(maxQualityValue, baseFile.mergeQV[readStart + queryStart + i]);
-                }
-                qvMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "DeletionQV") {
-                assert(baseFile.deletionQV.size() > 0 &&
-                       baseFile.deletionQV.size() >= readStart + readLength);
-                std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    // cap quality value
-                    qvMetric[offsetBegin + baseToAlignmentMap[i]] =
-                        std::min(maxQualityValue, baseFile.deletionQV[readStart + queryStart + i]);
-                }
-                qvMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "DeletionTag") {
-                assert(baseFile.deletionTag.size() > 0 &&
-                       baseFile.deletionTag.size() >= readStart + readLength);
-                std::fill(&tagMetric[offsetBegin], &tagMetric[offsetEnd], '-');
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    assert(offsetBegin + baseToAlignmentMap[i] < tagMetric.size());
-                    tagMetric[offsetBegin + baseToAlignmentMap[i]] =
-                        baseFile.deletionTag[readStart + queryStart + i];
-                }
-                tagMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "PulseIndex") {
-                assert(baseFile.pulseIndex.size() > 0 &&
-                       baseFile.pulseIndex.size() >= readStart + readLength);
-                std::fill(&pulseMetric[offsetBegin], &pulseMetric[offsetEnd], 0);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    pulseMetric[offsetBegin + baseToAlignmentMap[i]] =
-                        baseFile.pulseIndex[readStart + queryStart + i];
-                }
-                pulseMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "SubstitutionTag") {
-                assert(baseFile.substitutionTag.size() > 0 &&
-                       baseFile.substitutionTag.size() >= readStart + readLength);
-                std::fill(&tagMetric[offsetBegin], &tagMetric[offsetEnd], '-');
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    tagMetric[offsetBegin + baseToAlignmentMap[i]] =
-                        baseFile.substitutionTag[readStart + queryStart + i];
-                }
-                tagMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "SubstitutionQV") {
-                assert(baseFile.substitutionQV.size() > 0 &&
-                       baseFile.substitutionQV.size() >= readStart + readLength);
-                std::fill(&qvMetric[offsetBegin], &qvMetric[offsetEnd], missingPulseIndex);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    qvMetric[offsetBegin + baseToAlignmentMap[i]] = std::min(
-                        maxQualityValue, baseFile.substitutionQV[readStart + queryStart + i]);
-                }
-                qvMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "ClassifierQV") {
-                assert(pulseFile.classifierQV.size() > 0 &&
-                       pulseFile.classifierQV.size() >= readStart + readLength);
-                std::vector<float> newClassifierQV;
-                newClassifierQV.resize(ungappedAlignedSequenceLength);
-                // For the data used for this table, it is possible to simply
-                // reference the data for the bas file,  but for the pls file,
-                // it is necessary to copy since there is a packing of data.
-                hdfPlsReader.CopyFieldAt(pulseFile, "ClassifierQV", plsReadIndex,
-                                         &baseToPulseIndexMap[queryStart], &newClassifierQV[0],
-                                         ungappedAlignedSequenceLength);
-
-                std::fill(&floatMetric[offsetBegin], &floatMetric[offsetEnd], NaN);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    floatMetric[offsetBegin + baseToAlignmentMap[i]] = newClassifierQV[i];
-                }
-                floatMetric[offsetBegin + alignedSequenceLength] = 0;
-
-                /*            } else if (curMetric == "StartTimeOffset") {
-                // StartTimeOffset is a subset of StartFrame.
-                std::vector<UInt> newStartFrame;
-                ComputeStartFrame(baseFile, pulseFile, hdfBasReader, hdfPlsReader,
-                                  useBaseFile, usePulseFile, lookupTable,
-                                  baseToPulseIndexMap, newStartFrame);
-
-                startTimeOffsetMetric[offsetBegin] = newStartFrame[queryStart];
-*/
-            } else if (curMetric == "StartFrame") {
-                std::vector<UInt> newStartFrame;
-                ComputeStartFrame(baseFile, pulseFile, hdfBasReader, hdfPlsReader, useBaseFile,
-                                  usePulseFile, lookupTable, baseToPulseIndexMap, newStartFrame);
-                std::fill(&timeMetric[offsetBegin], &timeMetric[offsetEnd], missingPulseIndex);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    timeMetric[offsetBegin + baseToAlignmentMap[i]] = newStartFrame[queryStart + i];
-                }
-                timeMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "StartFrameBase") {
-                // Sneaky metric, compute StartFrame from BaseCalls only.
-                std::vector<UInt> newStartFrame;
-                ComputeStartFrameFromBase(baseFile, hdfBasReader, useBaseFile, lookupTable,
-                                          newStartFrame);
-                std::fill(&timeMetric[offsetBegin], &timeMetric[offsetEnd], missingPulseIndex);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    timeMetric[offsetBegin + baseToAlignmentMap[i]] = newStartFrame[queryStart + i];
-                }
-                timeMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "StartFramePulse") {
-                // Sneaky metric, compute StartFrame from PulseCalls only.
-                std::vector<UInt> newStartFrame;
-                ComputeStartFrameFromPulse(pulseFile, hdfPlsReader, usePulseFile, lookupTable,
-                                           baseToPulseIndexMap, newStartFrame);
-                std::fill(&timeMetric[offsetBegin], &timeMetric[offsetEnd], missingPulseIndex);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    timeMetric[offsetBegin + baseToAlignmentMap[i]] = newStartFrame[queryStart + i];
-                }
-                timeMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "PreBaseFrames") {
-                // Directly load baseFile.PreBaseFrames.
-                // DON'T compute it from PulseCalls even if you can.
-                assert(baseFile.preBaseFrames.size() > 0 &&
-                       baseFile.preBaseFrames.size() >= readStart + readLength);
-                std::fill(&frameRateMetric[offsetBegin], &frameRateMetric[offsetEnd],
-                          missingFrameRateValue);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    frameRateMetric[offsetBegin + baseToAlignmentMap[i]] =
-                        baseFile.preBaseFrames[readStart + queryStart + i];
-                }
-                frameRateMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "WidthInFrames" || curMetric == "PulseWidth") {
-                // For legacy reasons, it's possible the width in frames is
-                // stored in the bas file. If this is the case, use the width
-                // in frames there.  Otherwise, use the width in frames stored
-                // in the pls file.
-                std::vector<uint16_t> newWidthInFrames;
-                newWidthInFrames.resize(ungappedAlignedSequenceLength);
-                if (usePulseFile) {
-                    hdfPlsReader.CopyFieldAt(pulseFile, "WidthInFrames", plsReadIndex,
-                                             &baseToPulseIndexMap[queryStart], &newWidthInFrames[0],
-                                             ungappedAlignedSequenceLength);
-                } else if (useBaseFile) {
-                    // basWidthInFrames data type uint16
-                    std::copy(&baseFile.basWidthInFrames[readStart + queryStart],
-                              &baseFile.basWidthInFrames[readStart + queryStart +
-                                                         ungappedAlignedSequenceLength],
-                              &newWidthInFrames[0]);
-                }
-
-                std::fill(&frameRateMetric[offsetBegin], &frameRateMetric[offsetEnd],
-                          missingFrameRateValue);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    frameRateMetric[offsetBegin + baseToAlignmentMap[i]] = newWidthInFrames[i];
-                }
-                frameRateMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "pkmid") {
-                // pkmid in cmp.h5 is MidSignal in pls.h5, but
-                // data type of MidSignal is uint16 in pls files,
-                // data type of pkmid is float in cmp files.
-                assert(usePulseFile);
-                std::vector<HalfWord> newMidSignal;
-                newMidSignal.resize(ungappedAlignedSequenceLength);
-                hdfPlsReader.CopyFieldAt(pulseFile, "MidSignal", plsReadIndex,
-                                         &baseToPulseIndexMap[queryStart], &newMidSignal[0],
-                                         ungappedAlignedSequenceLength, ungappedAlignedSequence);
-
-                std::fill(&floatMetric[offsetBegin], &floatMetric[offsetEnd], NaN);
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    floatMetric[offsetBegin + baseToAlignmentMap[i]] = newMidSignal[i];
-                }
-                floatMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "IPD") {
-                std::fill(&frameRateMetric[offsetBegin], &frameRateMetric[offsetEnd],
-                          missingFrameRateValue);
-
-                // IPD can be either (1) copied from baseFile.preBaseFrames
-                // or (2) computed from pulseFile.StartFrame and pulseFile.WidthInFrames
-                // Always use method (2) when possible as it is more accurate.
-                if (usePulseFile) {
-                    // Need to read StartFrame & WidthInFrames for the entire read,
-                    // not only for a subset of bases in the alignment
-                    assert(pulseFile.startFrame.size() > 0);
-                    assert(pulseFile.plsWidthInFrames.size() > 0);
-                    std::vector<UInt> newStartFrame;
-                    newStartFrame.resize(readLength);
-                    hdfPlsReader.CopyFieldAt(pulseFile, "StartFrame", plsReadIndex,
-                                             &baseToPulseIndexMap[0], &newStartFrame[0],
-                                             readLength);
-
-                    std::vector<uint16_t> newWidthInFrames;
-                    newWidthInFrames.resize(readLength);
-                    hdfPlsReader.CopyFieldAt(pulseFile, "WidthInFrames", plsReadIndex,
-                                             &baseToPulseIndexMap[0], &newWidthInFrames[0],
-                                             readLength);
-
-                    for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                        // The IPD is undefined for the first base in a read.
-                        if (queryStart == 0 and i == 0) {
-                            frameRateMetric[offsetBegin + baseToAlignmentMap[i]] = 0;
-                        } else {
-                            frameRateMetric[offsetBegin + baseToAlignmentMap[i]] =
-                                newStartFrame[queryStart + i] - newStartFrame[i + queryStart - 1] -
-                                newWidthInFrames[i + queryStart - 1];
-                        }
-                    }
-                } else if (useBaseFile) {
-                    assert(baseFile.preBaseFrames.size() > 0);
-                    assert(baseFile.preBaseFrames.size() >= readStart + readLength);
-
-                    for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                        frameRateMetric[offsetBegin + baseToAlignmentMap[i]] =
-                            baseFile.preBaseFrames[readStart + queryStart + i];
+            std::vector<MetricThreadArgs> threadArgs(numThreads);
+            std::vector<pthread_t> threads(numThreads);
+            for (int t = 0; t < numThreads; t++) {
+                MetricThreadArgs &args = threadArgs[t];
+                args.baseFile = &baseFile;
+                args.pulseFields = &pulseFields;
+                args.preBaseFramesIncluded = preBaseFramesIncluded;
+                args.useBaseFile = useBaseFile;
+                args.usePulseFile = usePulseFile;
+                args.lookupTables = &lookupTables;
+                args.alnArrayLength = alnArrayLength;
+                args.curMetric = &curMetric;
+                args.pulseMetric = &pulseMetric;
+                args.qvMetric = &qvMetric;
+                args.frameRateMetric = &frameRateMetric;
+                args.timeMetric = &timeMetric;
+                args.tagMetric = &tagMetric;
+                args.floatMetric = &floatMetric;
+                args.firstIndex = chunkBegin;
+                args.lastIndex = chunkEnd;
+                args.threadIndex = t;
+                args.numThreads = numThreads;
+            }
+            if (numThreads == 1) {
+                ComputeMetricForAlignmentBlocks(&threadArgs[0]);
+            } else {
+                for (int t = 0; t < numThreads; t++) {
+                    if (pthread_create(&threads[t], NULL, ComputeMetricForAlignmentBlocks,
+                                       &threadArgs[t]) != 0) {
+                        std::cout << "ERROR, could not start a thread to compute " << curMetric
+                                  << "." << std::endl;
+                        std::exit(EXIT_FAILURE);
                     }
                 }
-                frameRateMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else if (curMetric == "Light") {
-                // Light can be computed from pulseFile.meanSignal and
-                // pulseFile.plsWidthInFrames. Might have been deprecated.
-                assert(usePulseFile);
-                std::fill(&frameRateMetric[offsetBegin], &frameRateMetric[offsetEnd],
-                          missingFrameRateValue);
-
-                std::vector<uint16_t> newMeanSignal;
-                newMeanSignal.resize(ungappedAlignedSequenceLength);
-                hdfPlsReader.CopyFieldAt(pulseFile, "MeanSignal", plsReadIndex,
-                                         &baseToPulseIndexMap[queryStart], &newMeanSignal[0],
-                                         ungappedAlignedSequenceLength, ungappedAlignedSequence);
-
-                std::vector<uint16_t> newWidthInFrames;
-                newWidthInFrames.resize(ungappedAlignedSequenceLength);
-                hdfPlsReader.CopyFieldAt(pulseFile, "WidthInFrames", plsReadIndex,
-                                         &baseToPulseIndexMap[queryStart], &newWidthInFrames[0],
-                                         ungappedAlignedSequenceLength);
-
-                for (i = 0; i < ungappedAlignedSequenceLength; i++) {
-                    frameRateMetric[offsetBegin + baseToAlignmentMap[i]] =
-                        newMeanSignal[i] * newWidthInFrames[i];
+                for (int t = 0; t < numThreads; t++) {
+                    pthread_join(threads[t], NULL);
                 }
-                frameRateMetric[offsetBegin + alignedSequenceLength] = 0;
-
-            } else {
-                std::cout << "ERROR, unknown metric " << curMetric << std::endl;
-                std::exit(EXIT_FAILURE);
             }
         }
 
@@ -1689,6 +1874,11 @@ int main(int argc, char *argv[])
                           "Set a limit (in GB) on the memory to buffer data with -bymetric "
                           "(default value: 4 GB). Use -byread if the limit is exceeded.",
                           CommandLineParser::PositiveInteger);
+    int numThreads = 1;
+    clp.RegisterIntOption("nproc", &numThreads,
+                          "(1) Number of threads that compute a metric for the alignments of a "
+                          "movie with -bymetric.",
+                          CommandLineParser::PositiveInteger);
     int metaNElements, rawChunkSize, rawNElements;
     metaNElements = 0;
     rawChunkSize = 0;
@@ -2157,7 +2347,7 @@ int main(int argc, char *argv[])
                 // Compute the metric and write it to cmp.h5.
                 WriteMetric(cmpFile, baseFile, pulseFile, cmpReader, hdfBasReader, hdfPlsReader,
                             hdfCcsReader, useBaseFile, usePulseFile, useCcsOnly, lookupTables,
-                            groupedLookupTablesIndexPairs, curMetric);
+                            groupedLookupTablesIndexPairs, curMetric, numThreads);
 
                 // Clear cached fields unless they are required by the next metric.
                 ClearCachedFields(baseFile, pulseFile, hdfBasReader, hdfPlsReader, hdfCcsReader,
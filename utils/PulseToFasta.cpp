@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -14,10 +15,25 @@
 #include <pbdata/reads/RegionTable.hpp>
 #include <pbdata/utils.hpp>
 #include <pbdata/utils/TimeUtils.hpp>
+#include "../iblasr/BatchConverter.hpp"
+#include "../iblasr/RegionTableStream.hpp"
 
 char VERSION[] = "v1.0.0";
 char PERFORCE_VERSION_STRING[] = "$Change: 126414 $";
 
+// A read of a bax/pls.h5 file with what is needed to print it: its
+// ccs sequence with -best, the regions of its zmw, and where it was
+// simulated from.
+class PlsRead
+{
+public:
+    SMRTSequence seq;
+    SMRTSequence ccsSeq;
+    RegionTable zmwRegionTable;
+    DNALength simulatedCoordinate;
+    DNALength simulatedSequenceIndex;
+};
+
 int main(int argc, char* argv[])
 {
     std::string program = "pls2fasta";
@@ -29,7 +45,6 @@ int main(int argc, char* argv[])
     bool trimByRegion, maskByRegion;
     trimByRegion = false;
     maskByRegion = false;
-    RegionTable regionTable;
     std::string regionsFOFNName = "";
     std::vector<std::string> regionFileNames;
     bool splitSubreads = true;
@@ -42,6 +57,7 @@ int main(int argc, char* argv[])
     std::vector<int> holeNumbers;
     CommandLineParser clp;
     bool printOnlyBest = false;
+    int numThreads = 1;
 
     clp.SetProgramName(program);
     clp.SetVersion(versionString);
@@ -72,6 +88,10 @@ int main(int argc, char* argv[])
     clp.RegisterFlagOption("best", &printOnlyBest,
                            "If a CCS sequence exists, print this.  Otherwise, print the longest"
                            "subread.  This does not support fastq.");
+    clp.RegisterIntOption("nproc", &numThreads,
+                          "(1) Number of threads that split and format reads. Output is in "
+                          "the order of the input.",
+                          CommandLineParser::PositiveInteger);
     std::string description =
         ("Converts plx.h5/bax.h5/fofn files to fasta or fastq files. Although fasta files are "
          "provided"
@@ -106,15 +126,200 @@ int main(int argc, char* argv[])
 
     std::ofstream fastaOut;
     CrucialOpen(fastaOutName, fastaOut);
-    HDFRegionTableReader hdfRegionReader;
     sort(holeNumbers.begin(), holeNumbers.end());
 
     std::vector<int> pls2rgn = MapPls2Rgn(plsFileNames, regionFileNames);
 
+    //
+    // Format a read as fasta or fastq into output.  This runs on
+    // -nproc threads at once, and only touches the read.
+    //
+    auto formatRead = [&](PlsRead& read, std::string& output) {
+        SMRTSequence& seq = read.seq;
+        SMRTSequence& ccsSeq = read.ccsSeq;
+        RegionTable& zmwRegionTable = read.zmwRegionTable;
+        DNALength& simulatedCoordinate = read.simulatedCoordinate;
+        DNALength& simulatedSequenceIndex = read.simulatedSequenceIndex;
+        std::vector<ReadInterval> subreadIntervals;
+        std::stringstream fastaOut;
+
+        if (printCcs == true) {
+            if (printFastq == false) {
+                seq.PrintSeq(fastaOut);
+            } else {
+                seq.PrintFastq(fastaOut, lineLength);
+            }
+            seq.Free();
+            output = fastaOut.str();
+            return;
+        }
+
+        //
+        // Determine the high quality boundaries of the read.  This is
+        // the full read is no hq regions exist, or it is stated to
+        // ignore regions.
+        //
+        DNALength hqReadStart, hqReadEnd;
+        int hqRegionScore;
+        if (GetReadTrimCoordinates(seq, seq.zmwData, zmwRegionTable, hqReadStart, hqReadEnd,
+                                   hqRegionScore) == false or
+            (trimByRegion == false and maskByRegion == false)) {
+            hqReadStart = 0;
+            hqReadEnd = seq.length;
+        }
+
+        //
+        // Mask off the low quality portions of the reads.
+        //
+        if (maskByRegion) {
+            if (hqReadStart > 0) {
+                std::fill(&seq.seq[0], &seq.seq[hqReadStart], 'N');
+            }
+            if (hqReadEnd != seq.length) {
+                std::fill(&seq.seq[hqReadEnd], &seq.seq[seq.length], 'N');
+            }
+        }
+
+        //
+        // Now possibly print the full read with masking.  This could be handled by making a
+        //
+        if (splitSubreads == false) {
+            ReadInterval wholeRead(0, seq.length);
+            // The set of subread intervals is just the entire read.
+            subreadIntervals.clear();
+            subreadIntervals.push_back(wholeRead);
+        } else {
+            //
+            // Print subread coordinates no matter whether or not reads have subreads.
+            //
+            if (zmwRegionTable.HasHoleNumber(seq.HoleNumber())) {
+                subreadIntervals =
+                    zmwRegionTable[seq.HoleNumber()].SubreadIntervals(seq.length, false, true);
+            } else {
+                subreadIntervals = {};
+            }
+        }
+        //
+        // Output all subreads as separate sequences.
+        //
+        SMRTSequence bestSubreadSequence;
+        int bestSubreadScore = -1;
+        int bestSubreadIndex = 0;
+        SMRTSequence bestSubread;
+        for (size_t intvIndex = 0; intvIndex < subreadIntervals.size(); intvIndex++) {
+            SMRTSequence subreadSequence, subreadSequenceRC;
+
+            subreadSequence.SubreadStart(subreadIntervals[intvIndex].start);
+            subreadSequence.SubreadEnd(subreadIntervals[intvIndex].end);
+
+            //
+            // When trimming by region, only output the parts of the
+            // subread that overlap the hq region.
+            //
+            if (trimByRegion == true) {
+                subreadSequence.SubreadStart(
+                    std::max((DNALength)subreadIntervals[intvIndex].start, hqReadStart));
+                subreadSequence.SubreadEnd(
+                    std::min((DNALength)subreadIntervals[intvIndex].end, hqReadEnd));
+            }
+
+            if (subreadSequence.SubreadStart() >= subreadSequence.SubreadEnd() or
+                subreadSequence.SubreadEnd() - subreadSequence.SubreadStart() <=
+                    DNALength(minSubreadLength)) {
+                //
+                // There is no high quality portion of this subread. Skip it.
+                //
+                continue;
+            }
+
+            if (hqRegionScore < minReadScore) {
+                continue;
+            }
+
+            //
+            // Print the subread, adding the coordinates as part of the title.
+            //
+            subreadSequence.ReferenceSubstring(seq, subreadSequence.SubreadStart(),
+                                               subreadSequence.SubreadLength());
+            std::stringstream titleStream;
+            titleStream << seq.title;
+            if (splitSubreads) {
+                //
+                // Add the subread coordinates if splitting on subread.
+                //
+                titleStream << "/" << subreadSequence.SubreadStart() << "_"
+                            << subreadSequence.SubreadEnd();
+            }
+
+            //
+            // If running on simulated data, add where the values were simulated from.
+            //
+            if (addSimulatedData) {
+                titleStream << ((FASTASequence*)&seq)->title << "/chrIndex_"
+                            << simulatedSequenceIndex << "/position_" << simulatedCoordinate;
+                ((FASTASequence*)&seq)->CopyTitle(titleStream.str());
+            }
+
+            subreadSequence.CopyTitle(titleStream.str());
+
+            //
+            // Eventually replace with WriterAgglomerate.
+            //
+            if (printOnlyBest == false) {
+                if (subreadSequence.length > 0) {
+                    if (printFastq == false) {
+                        ((FASTASequence*)&subreadSequence)->PrintSeq(fastaOut);
+                    } else {
+                        subreadSequence.PrintFastq(fastaOut, lineLength);
+                    }
+                }
+            } else {
+                int subreadWeightedScore = subreadSequence.length * hqRegionScore;
+                if (subreadWeightedScore > bestSubreadScore) {
+                    bestSubreadIndex = intvIndex;
+                    (void)(bestSubreadIndex);
+                    bestSubread = subreadSequence;
+                    bestSubreadScore = subreadWeightedScore;
+                }
+            }
+        }
+
+        if (printOnlyBest) {
+            if (ccsSeq.length > 0) {
+                if (printFastq == false) {
+                    ccsSeq.PrintSeq(fastaOut);
+                } else {
+                    ccsSeq.PrintFastq(fastaOut, ccsSeq.length);
+                }
+            } else {
+                if (bestSubreadScore >= 0) {
+                    if (printFastq == false) {
+                        bestSubread.PrintSeq(fastaOut);
+                    } else {
+                        bestSubread.PrintFastq(fastaOut, bestSubread.length);
+                    }
+                    bestSubread.Free();
+                }
+            }
+            ccsSeq.Free();
+        }
+        seq.Free();
+        output = fastaOut.str();
+    };
+    BatchConverter<PlsRead, std::string, decltype(formatRead)> formatter(formatRead, numThreads);
+
     for (size_t plsFileIndex = 0; plsFileIndex < plsFileNames.size(); plsFileIndex++) {
-        if (trimByRegion or maskByRegion or splitSubreads) {
-            hdfRegionReader.Initialize(regionFileNames[pls2rgn[plsFileIndex]]);
-            hdfRegionReader.ReadTable(regionTable);
+        //
+        // Regions are read along with the reads rather than loading
+        // the whole table of the file first.
+        //
+        RegionTableStream regionTableStream;
+        bool useRegions = (trimByRegion or maskByRegion or splitSubreads);
+        if (useRegions and
+            regionTableStream.Initialize(regionFileNames[pls2rgn[plsFileIndex]]) == 0) {
+            std::cout << "ERROR, could not read the region table of "
+                      << regionFileNames[pls2rgn[plsFileIndex]] << std::endl;
+            std::exit(EXIT_FAILURE);
         }
 
         ReaderAgglomerate reader;
@@ -145,199 +350,81 @@ int main(int argc, char* argv[])
             std::exit(EXIT_FAILURE);
         }
 
-        DNALength simulatedCoordinate;
-        DNALength simulatedSequenceIndex;
         reader.SkipReadQuality();
-        SMRTSequence seq;
-        std::vector<ReadInterval> subreadIntervals;
-        ;
-        SMRTSequence ccsSeq;
-        while (reader.GetNextBases(seq, printFastq)) {
-            if (printOnlyBest) {
-                ccsReader.GetNext(ccsSeq);
-            }
-
-            if (holeNumbers.size() != 0 and
-                binary_search(holeNumbers.begin(), holeNumbers.end(), seq.zmwData.holeNumber) ==
-                    false) {
-                continue;
-            }
-
-            if (seq.length == 0) {
-                continue;
-            }
-
-            if (addSimulatedData) {
-                reader.hdfBasReader.simulatedCoordinateArray.Read(reader.hdfBasReader.curRead - 1,
-                                                                  reader.hdfBasReader.curRead,
-                                                                  &simulatedCoordinate);
-                reader.hdfBasReader.simulatedSequenceIndexArray.Read(
-                    reader.hdfBasReader.curRead - 1, reader.hdfBasReader.curRead,
-                    &simulatedSequenceIndex);
-            }
-
-            if (printCcs == true) {
-                if (printFastq == false) {
-                    seq.PrintSeq(fastaOut);
-                } else {
-                    seq.PrintFastq(fastaOut, lineLength);
-                }
-                continue;
-            }
-
-            //
-            // Determine the high quality boundaries of the read.  This is
-            // the full read is no hq regions exist, or it is stated to
-            // ignore regions.
-            //
-            DNALength hqReadStart, hqReadEnd;
-            int hqRegionScore;
-            if (GetReadTrimCoordinates(seq, seq.zmwData, regionTable, hqReadStart, hqReadEnd,
-                                       hqRegionScore) == false or
-                (trimByRegion == false and maskByRegion == false)) {
-                hqReadStart = 0;
-                hqReadEnd = seq.length;
-            }
-
-            //
-            // Mask off the low quality portions of the reads.
-            //
-            if (maskByRegion) {
-                if (hqReadStart > 0) {
-                    std::fill(&seq.seq[0], &seq.seq[hqReadStart], 'N');
-                }
-                if (hqReadEnd != seq.length) {
-                    std::fill(&seq.seq[hqReadEnd], &seq.seq[seq.length], 'N');
-                }
-            }
-
-            //
-            // Now possibly print the full read with masking.  This could be handled by making a
-            //
-            if (splitSubreads == false) {
-                ReadInterval wholeRead(0, seq.length);
-                // The set of subread intervals is just the entire read.
-                subreadIntervals.clear();
-                subreadIntervals.push_back(wholeRead);
-            } else {
-                //
-                // Print subread coordinates no matter whether or not reads have subreads.
-                //
-                if (regionTable.HasHoleNumber(seq.HoleNumber())) {
-                    subreadIntervals =
-                        regionTable[seq.HoleNumber()].SubreadIntervals(seq.length, false, true);
-                } else {
-                    subreadIntervals = {};
-                }
-            }
-            //
-            // Output all subreads as separate sequences.
-            //
-            SMRTSequence bestSubreadSequence;
-            int bestSubreadScore = -1;
-            int bestSubreadIndex = 0;
-            SMRTSequence bestSubread;
-            for (size_t intvIndex = 0; intvIndex < subreadIntervals.size(); intvIndex++) {
-                SMRTSequence subreadSequence, subreadSequenceRC;
-
-                subreadSequence.SubreadStart(subreadIntervals[intvIndex].start);
-                subreadSequence.SubreadEnd(subreadIntervals[intvIndex].end);
 
-                //
-                // When trimming by region, only output the parts of the
-                // subread that overlap the hq region.
-                //
-                if (trimByRegion == true) {
-                    subreadSequence.SubreadStart(
-                        std::max((DNALength)subreadIntervals[intvIndex].start, hqReadStart));
-                    subreadSequence.SubreadEnd(
-                        std::min((DNALength)subreadIntervals[intvIndex].end, hqReadEnd));
+        //
+        // Read a batch of reads with their regions.  HDF files are
+        // only read on this thread.
+        //
+        const size_t batchSize = 256 * numThreads;
+        auto readBatch = [&](std::vector<PlsRead>& batch) {
+            batch.resize(batchSize);
+            size_t numRead = 0;
+            while (numRead < batchSize and reader.GetNextBases(batch[numRead].seq, printFastq)) {
+                PlsRead& read = batch[numRead];
+                SMRTSequence& seq = read.seq;
+                if (printOnlyBest) {
+                    ccsReader.GetNext(read.ccsSeq);
                 }
 
-                if (subreadSequence.SubreadStart() >= subreadSequence.SubreadEnd() or
-                    subreadSequence.SubreadEnd() - subreadSequence.SubreadStart() <=
-                        DNALength(minSubreadLength)) {
-                    //
-                    // There is no high quality portion of this subread. Skip it.
-                    //
+                if (holeNumbers.size() != 0 and
+                    binary_search(holeNumbers.begin(), holeNumbers.end(), seq.zmwData.holeNumber) ==
+                        false) {
                     continue;
                 }
 
-                if (hqRegionScore < minReadScore) {
+                if (seq.length == 0) {
                     continue;
                 }
 
-                //
-                // Print the subread, adding the coordinates as part of the title.
-                //
-                subreadSequence.ReferenceSubstring(seq, subreadSequence.SubreadStart(),
-                                                   subreadSequence.SubreadLength());
-                std::stringstream titleStream;
-                titleStream << seq.title;
-                if (splitSubreads) {
-                    //
-                    // Add the subread coordinates if splitting on subread.
-                    //
-                    titleStream << "/" << subreadSequence.SubreadStart() << "_"
-                                << subreadSequence.SubreadEnd();
-                }
-
-                //
-                // If running on simulated data, add where the values were simulated from.
-                //
                 if (addSimulatedData) {
-                    titleStream << ((FASTASequence*)&seq)->title << "/chrIndex_"
-                                << simulatedSequenceIndex << "/position_" << simulatedCoordinate;
-                    ((FASTASequence*)&seq)->CopyTitle(titleStream.str());
+                    reader.hdfBasReader.simulatedCoordinateArray.Read(
+                        reader.hdfBasReader.curRead - 1, reader.hdfBasReader.curRead,
+                        &read.simulatedCoordinate);
+                    reader.hdfBasReader.simulatedSequenceIndexArray.Read(
+                        reader.hdfBasReader.curRead - 1, reader.hdfBasReader.curRead,
+                        &read.simulatedSequenceIndex);
                 }
 
-                subreadSequence.CopyTitle(titleStream.str());
-
-                //
-                // Eventually replace with WriterAgglomerate.
-                //
-                if (printOnlyBest == false) {
-                    if (subreadSequence.length > 0) {
-                        if (printFastq == false) {
-                            ((FASTASequence*)&subreadSequence)->PrintSeq(fastaOut);
-                        } else {
-                            subreadSequence.PrintFastq(fastaOut, lineLength);
-                        }
-                    }
+                if (useRegions) {
+                    regionTableStream.GetZmwRegions(seq.HoleNumber(), read.zmwRegionTable);
                 } else {
-                    int subreadWeightedScore = subreadSequence.length * hqRegionScore;
-                    if (subreadWeightedScore > bestSubreadScore) {
-                        bestSubreadIndex = intvIndex;
-                        (void)(bestSubreadIndex);
-                        bestSubread = subreadSequence;
-                        bestSubreadScore = subreadWeightedScore;
-                    }
+                    read.zmwRegionTable.Reset();
                 }
+                numRead++;
             }
-
-            if (printOnlyBest) {
-                if (ccsSeq.length > 0) {
-                    if (printFastq == false) {
-                        ccsSeq.PrintSeq(fastaOut);
-                    } else {
-                        ccsSeq.PrintFastq(fastaOut, ccsSeq.length);
-                    }
-                } else {
-                    if (bestSubreadScore >= 0) {
-                        if (printFastq == false) {
-                            bestSubread.PrintSeq(fastaOut);
-                        } else {
-                            bestSubread.PrintFastq(fastaOut, bestSubread.length);
-                        }
-                        bestSubread.Free();
-                    }
-                }
-                ccsSeq.Free();
+            batch.resize(numRead);
+        };
+
+        //
+        // Reads are read and written on this thread, in input order.
+        // The next batch is read while the current one is formatted,
+        // and the formatted reads of a batch are written at once.
+        //
+        std::vector<PlsRead> batches[2];
+        std::vector<std::string> formattedBatches[2];
+        int current = 0;
+        readBatch(batches[current]);
+        formatter.Start(batches[current], formattedBatches[current]);
+        while (batches[current].size() > 0) {
+            int next = 1 - current;
+            readBatch(batches[next]);
+            formatter.Wait();
+            if (batches[next].size() > 0) {
+                formatter.Start(batches[next], formattedBatches[next]);
             }
-            seq.Free();
+            std::string batchOutput;
+            for (size_t i = 0; i < formattedBatches[current].size(); i++) {
+                batchOutput += formattedBatches[current][i];
+            }
+            fastaOut.write(batchOutput.data(), batchOutput.size());
+            formattedBatches[current].clear();
+            batches[current].clear();
+            current = next;
         }
+        formatter.Wait();
         reader.Close();
-        hdfRegionReader.Close();
+        regionTableStream.Close();
     }
     std::cerr << "[INFO] " << GetTimestamp() << " [" << program << "] ended." << std::endl;
 }
@@ -1,3 +1,10 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -10,11 +17,12 @@
 #include <pbdata/FASTAReader.hpp>
 #include <pbdata/FASTASequence.hpp>
 #include <pbdata/NucConversion.hpp>
+#include "../iblasr/BucketSuffixSorter.hpp"
 
 void PrintUsage()
 {
     std::cout << "usage: sawriter saOut fastaIn [fastaIn2 fastaIn3 ...] [-blt p] [-larsson] "
-                 "[-4bit] [-manmy] [-kar]"
+                 "[-4bit] [-manmy] [-kar] [-maxMemoryMB m]"
               << std::endl;
     std::cout << "   or  sawriter fastaIn  (writes to fastIn.sa)." << std::endl;
     std::cout << "       -blt p      Build a lookup table on prefixes of length 'p'. This speeds "
@@ -49,10 +57,25 @@ void PrintUsage()
         << "                   normal larsson." << std::endl
         << "       -welterweight N use a difference cover of size N for building the suffix array. "
            " Valid values are 7,32,64,111, and 2281."
+        << std::endl
+        << "       -maxMemoryMB m  Build the array in buckets of suffixes with the same prefix, "
+           "using at most"
+        << std::endl
+        << "                   m megabytes besides the lookup table.  The sequence takes a byte "
+           "per base, and"
+        << std::endl
+        << "                   the rest is used to sort ranges of buckets, which are written to "
+           "saOut.buckets"
+        << std::endl
+        << "                   as they are sorted.  This needs as much free disk as the array, "
+           "and can not"
+        << std::endl
+        << "                   be combined with a choice of method (-larsson, -mamy, -kark, "
+           "-welter, ...)."
         << std::endl;
 }
 
-int main(int argc, char* argv[])
+int main(int argc, char *argv[])
 {
 
     if (argc < 2) {
@@ -73,6 +96,8 @@ int main(int argc, char* argv[])
     SAType saBuildType = larsson;
     int read4BitCompressed = 0;
     int diffCoverSize = 0;
+    int maxMemoryMB = 0;
+    bool saBuildTypeGiven = false;
     while (argi < argc) {
         if (strlen(argv[argi]) > 0 and argv[argi][0] == '-') {
             parsingOptions = 1;
@@ -95,19 +120,27 @@ int main(int argc, char* argv[])
                 }
             } else if (strcmp(argv[argi], "-mamy") == 0) {
                 saBuildType = manmy;
+                saBuildTypeGiven = true;
             } else if (strcmp(argv[argi], "-larsson") == 0) {
                 saBuildType = larsson;
+                saBuildTypeGiven = true;
             } else if (strcmp(argv[argi], "-mcilroy") == 0) {
                 saBuildType = mcilroy;
+                saBuildTypeGiven = true;
             } else if (strcmp(argv[argi], "-slow") == 0) {
                 saBuildType = slow;
+                saBuildTypeGiven = true;
             } else if (strcmp(argv[argi], "-kark") == 0) {
                 saBuildType = kark;
+                saBuildTypeGiven = true;
             } else if (strcmp(argv[argi], "-mafe") == 0) {
                 saBuildType = mafe;
+                saBuildTypeGiven = true;
             } else if (strcmp(argv[argi], "-welter") == 0) {
                 saBuildType = welter;
+                saBuildTypeGiven = true;
             } else if (strcmp(argv[argi], "-welterweight") == 0) {
+                saBuildTypeGiven = true;
                 if (argi < argc - 1) {
                     diffCoverSize = atoi(argv[++argi]);
                 } else {
@@ -124,6 +157,17 @@ int main(int argc, char* argv[])
                     std::cout << "Larger numbers use less space but are more slow." << std::endl;
                     std::exit(EXIT_FAILURE);
                 }
+            } else if (strcmp(argv[argi], "-maxMemoryMB") == 0) {
+                if (argi < argc - 1) {
+                    maxMemoryMB = atoi(argv[++argi]);
+                    if (maxMemoryMB <= 0) {
+                        std::cout << argv[argi] << " is not a valid memory limit." << std::endl;
+                        std::exit(EXIT_FAILURE);
+                    }
+                } else {
+                    std::cout << "Please specify a memory limit in megabytes." << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
             } else if (strcmp(argv[argi], "-4bit") == 0) {
                 read4BitCompressed = 1;
             } else if (strcmp(argv[argi], "-h") == 0 or strcmp(argv[argi], "-help") == 0 or
@@ -139,6 +183,12 @@ int main(int argc, char* argv[])
         ++argi;
     }
 
+    if (maxMemoryMB > 0 and saBuildTypeGiven) {
+        std::cout << "ERROR, -maxMemoryMB builds the array in buckets, and can not be combined "
+                  << "with a choice of method." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
     if (inFiles.size() == 0) {
         //
         // Special use case: the input file is a fasta file.  Write to that file + .sa
@@ -203,7 +253,78 @@ int main(int argc, char* argv[])
     //  sa.InitAsciiCharDNAAlphabet(alphabet);
     sa.InitThreeBitDNAAlphabet(alphabet);
 
-    if (saBuildType == manmy) {
+    //
+    // With a memory limit, ranges of buckets are sorted into a buffer
+    // and appended to a scratch file, so that only the sequence, the
+    // sorting workspace and one range are held in memory.  The scratch
+    // file is then mapped as the array, and the lookup table and the
+    // .sa file are built from the map as from an array in memory; its
+    // pages are read from disk as they are needed, and may be dropped
+    // again.
+    //
+    std::string bucketsFileName = saFile + ".buckets";
+    SAIndex *mappedIndex = NULL;
+    size_t mappedBytes = 0;
+    if (maxMemoryMB > 0) {
+        size_t maxMemory = size_t(maxMemoryMB) << 20;
+        size_t seqMemory = size_t(seq.length) * sizeof(Nucleotide);
+        size_t rangeMemory = (maxMemory > seqMemory) ? (maxMemory - seqMemory) / 2 : 0;
+        DNALength rangeCapacity =
+            DNALength(std::min(rangeMemory / sizeof(SAIndex), size_t(seq.length) + 1));
+        BucketSuffixSorter<Nucleotide> sorter;
+        DNALength largestBucket = 0;
+        bool fits = (rangeCapacity > 0 and
+                     sorter.Initialize(seq.seq, seq.length, maxMemory - seqMemory - rangeMemory));
+        for (UInt code = 0; fits and code < sorter.NumPrefixCodes(); code++) {
+            largestBucket = std::max(largestBucket, sorter.PrefixCount(code));
+        }
+        if (not fits or largestBucket > rangeCapacity) {
+            std::cout << "ERROR, " << maxMemoryMB << " MB is not enough to build the suffix array "
+                      << "of " << seq.length << " bases." << std::endl;
+            std::cout << "The sequence alone takes " << (seqMemory >> 20) + 1 << " MB."
+                      << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        std::ofstream bucketsOut;
+        CrucialOpen(bucketsFileName, bucketsOut, std::ios::out | std::ios::binary);
+        std::vector<SAIndex> range(rangeCapacity);
+        UInt firstCode = 0;
+        while (firstCode < sorter.NumPrefixCodes()) {
+            UInt endCode = firstCode;
+            DNALength rangeSize = 0;
+            while (endCode < sorter.NumPrefixCodes() and
+                   rangeSize + sorter.PrefixCount(endCode) <= rangeCapacity) {
+                rangeSize += sorter.PrefixCount(endCode);
+                endCode++;
+            }
+            sorter.SortSuffixes(firstCode, endCode, &range[0]);
+            bucketsOut.write((char *)&range[0], sizeof(SAIndex) * rangeSize);
+            firstCode = endCode;
+        }
+        bucketsOut.close();
+        if (not bucketsOut) {
+            std::cout << "ERROR, could not write " << bucketsFileName << "." << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        std::vector<SAIndex>().swap(range);
+
+        mappedBytes = size_t(seq.length) * sizeof(SAIndex);
+        int bucketsFd = open(bucketsFileName.c_str(), O_RDONLY);
+        void *map = (bucketsFd >= 0 and mappedBytes > 0)
+                        ? mmap(NULL, mappedBytes, PROT_READ, MAP_PRIVATE, bucketsFd, 0)
+                        : MAP_FAILED;
+        if (bucketsFd >= 0) {
+            close(bucketsFd);
+        }
+        if (map == MAP_FAILED) {
+            std::cout << "ERROR, could not map " << bucketsFileName << "." << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        mappedIndex = static_cast<SAIndex *>(map);
+        sa.index = mappedIndex;
+        sa.length = seq.length;
+    } else if (saBuildType == manmy) {
         sa.MMBuildSuffixArray(seq.seq, seq.length, alphabet);
     } else if (saBuildType == mcilroy) {
         sa.index = new SAIndex[seq.length + 1];
@@ -243,5 +364,12 @@ int main(int argc, char* argv[])
     }
     sa.Write(saFile);
 
+    if (mappedIndex != NULL) {
+        // The array belongs to the map, not to sa.
+        sa.index = NULL;
+        munmap(mappedIndex, mappedBytes);
+        std::remove(bucketsFileName.c_str());
+    }
+
     return 0;
 }
@@ -25,8 +25,17 @@
  * =====================================================================================
  */
 
+#include <sys/stat.h>
+
+#include <algorithm>
 #include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
 #include <iostream>
+#include <queue>
+#include <sstream>
+#include <unordered_set>
 
 #include <pbdata/defs.h>
 #include <alignment/algorithms/alignment/AlignmentUtils.hpp>
@@ -46,7 +55,12 @@
 #include <pbdata/sam/SAMReader.hpp>
 #include <pbdata/utils/SMRTReadUtils.hpp>
 #include <pbdata/utils/TimeUtils.hpp>
+#include "../iblasr/BatchConverter.hpp"
+#include "../iblasr/IntervalIndex.hpp"
 #include "../iblasr/RegisterFilterOptions.h"
+#ifdef USE_PBBAM
+#include "../iblasr/BamToSamStream.hpp"
+#endif
 
 //#define USE_GOOGLE_PROFILER
 #ifdef USE_GOOGLE_PROFILER
@@ -151,6 +165,342 @@ std::vector<unsigned int> ApplyHitPolicy(HitPolicy &hitPolicy,
     return hitIndices;
 }
 
+// Apply hit policy to the alignments of a single query, write the
+// selected ones to out and empty the group.
+void WriteQueryGroup(HitPolicy &hitPolicy, std::vector<SAMAlignment> &group, std::ostream &out)
+{
+    if (group.empty()) {
+        return;
+    }
+    std::sort(group.begin(), group.end(), byQNameScoreTStart);
+    std::vector<unsigned int> hitIndices = ApplyHitPolicy(hitPolicy, group, 0, group.size());
+    for (unsigned int i = 0; i < hitIndices.size(); i++) {
+        group[hitIndices[i]].PrintSAMAlignment(out);
+    }
+    group.clear();
+}
+
+// Hashes of the names of the queries whose groups have ended, to
+// detect input that is not grouped by query.  This costs 8 bytes per
+// query instead of the alignments themselves.  Two names with the same
+// hash only cost an unnecessary external sort.
+class SeenQueryNames
+{
+public:
+    // Add name and return false if it was added before.
+    bool Insert(const std::string &name);
+
+private:
+    static const size_t MaxRecent = 1 << 20;
+    std::vector<uint64_t> sorted;
+    std::unordered_set<uint64_t> recent;
+};
+
+inline bool SeenQueryNames::Insert(const std::string &name)
+{
+    uint64_t hash = std::hash<std::string>()(name);
+    if (std::binary_search(sorted.begin(), sorted.end(), hash) or not recent.insert(hash).second) {
+        return false;
+    }
+    if (recent.size() >= MaxRecent) {
+        size_t oldSize = sorted.size();
+        sorted.insert(sorted.end(), recent.begin(), recent.end());
+        std::sort(sorted.begin() + oldSize, sorted.end());
+        std::inplace_merge(sorted.begin(), sorted.begin() + oldSize, sorted.end());
+        recent.clear();
+    }
+    return true;
+}
+
+// What the filters found for one alignment.  The filters run on
+// several threads at once, so instead of printing warnings they
+// collect them here to be printed in input order.  The filter
+// criteria, which may print why an alignment fails them, are checked
+// in input order as well, on the converted alignment.
+class SAMFilterResult
+{
+public:
+    bool passes;
+    bool checkCriteria;
+    bool isFatal;
+    std::string messages;
+    AlignmentCandidate<> alignment;
+
+    void Reset()
+    {
+        passes = false;
+        checkCriteria = false;
+        isFatal = false;
+        messages.clear();
+        alignment = AlignmentCandidate<>();
+    }
+};
+
+// Reads alignments with samReader and returns those that pass the
+// filters, in input order.  The filters, which convert each alignment
+// against the reference, are evaluated on numThreads threads for a
+// batch of alignments at a time, while the next batch is read.
+template <typename T_Filter>
+class FilteredSAMReader
+{
+public:
+    typedef SAMReader<SAMFullReferenceSequence, SAMReadGroup, SAMAlignment> Reader;
+
+    FilteredSAMReader(Reader &samReaderP, T_Filter &filterAlignmentP,
+                      FilterCriteria &filterCriteriaP, int numThreadsP);
+
+    // Store the next alignment that passes the filters in
+    // samAlignment.  Returns false at the end of the input.
+    bool GetNextAlignment(SAMAlignment &samAlignment);
+
+private:
+    static const size_t BatchSizePerThread = 1024;
+    Reader &samReader;
+    FilterCriteria &filterCriteria;
+    size_t batchSize;
+    BatchConverter<SAMAlignment, SAMFilterResult, T_Filter> filter;
+    // Batch current is the one being returned, and the other one is
+    // being filtered unless the input has ended.
+    std::vector<SAMAlignment> batches[2];
+    std::vector<SAMFilterResult> results[2];
+    int current;
+    bool isStarted;
+    size_t batchIndex;
+
+    // Read up to batchSize alignments into batch.
+    void ReadBatch(std::vector<SAMAlignment> &batch);
+
+    // Make the filtered batch current, and start filtering the next
+    // one.  Returns false if there is none.
+    bool NextBatch();
+
+    // Print what the filters found for batch[i] and finish filtering it.
+    bool Passes(size_t i);
+};
+
+template <typename T_Filter>
+FilteredSAMReader<T_Filter>::FilteredSAMReader(Reader &samReaderP, T_Filter &filterAlignmentP,
+                                               FilterCriteria &filterCriteriaP, int numThreadsP)
+    : samReader(samReaderP)
+    , filterCriteria(filterCriteriaP)
+    , batchSize(BatchSizePerThread * numThreadsP)
+    , filter(filterAlignmentP, numThreadsP)
+    , current(0)
+    , isStarted(false)
+    , batchIndex(0)
+{
+}
+
+template <typename T_Filter>
+bool FilteredSAMReader<T_Filter>::GetNextAlignment(SAMAlignment &samAlignment)
+{
+    while (true) {
+        for (; batchIndex < batches[current].size(); batchIndex++) {
+            if (Passes(batchIndex)) {
+                samAlignment = batches[current][batchIndex++];
+                return true;
+            }
+        }
+        if (not NextBatch()) {
+            return false;
+        }
+    }
+}
+
+template <typename T_Filter>
+void FilteredSAMReader<T_Filter>::ReadBatch(std::vector<SAMAlignment> &batch)
+{
+    batch.resize(batchSize);
+    size_t numRead = 0;
+    while (numRead < batchSize and samReader.GetNextAlignment(batch[numRead])) {
+        numRead++;
+    }
+    batch.resize(numRead);
+}
+
+template <typename T_Filter>
+bool FilteredSAMReader<T_Filter>::NextBatch()
+{
+    int next = 1 - current;
+    if (not isStarted) {
+        ReadBatch(batches[next]);
+        filter.Start(batches[next], results[next]);
+        isStarted = true;
+    }
+    if (batches[next].empty()) {
+        return false;
+    }
+    // Read the batch after next while next is filtered.
+    ReadBatch(batches[current]);
+    filter.Wait();
+    current = next;
+    batchIndex = 0;
+    next = 1 - current;
+    if (not batches[next].empty()) {
+        filter.Start(batches[next], results[next]);
+    }
+    return true;
+}
+
+template <typename T_Filter>
+bool FilteredSAMReader<T_Filter>::Passes(size_t i)
+{
+    SAMFilterResult &result = results[current][i];
+    std::cout << result.messages;
+    if (result.isFatal) {
+        std::exit(EXIT_FAILURE);
+    }
+    if (result.checkCriteria) {
+        result.passes = filterCriteria.Satisfy(&result.alignment);
+    }
+    result.alignment = AlignmentCandidate<>();
+    return result.passes;
+}
+
+// Filter the alignments read by samReader one query at a time,
+// assuming that all alignments of a query are adjacent, as blasr
+// writes them.  Returns false as soon as a query shows up again after
+// its group ended, in which case the output is incomplete.
+template <typename T_Filter>
+bool FilterGroupedAlignments(FilteredSAMReader<T_Filter> &samReader, HitPolicy &hitPolicy,
+                             std::ostream &out)
+{
+    SeenQueryNames seenQueryNames;
+    std::vector<SAMAlignment> group;
+    SAMAlignment samAlignment;
+    while (samReader.GetNextAlignment(samAlignment)) {
+        if (group.size() > 0 and samAlignment.qName != group[0].qName) {
+            WriteQueryGroup(hitPolicy, group, out);
+        }
+        if (group.empty() and not seenQueryNames.Insert(samAlignment.qName)) {
+            return false;
+        }
+        group.push_back(samAlignment);
+    }
+    WriteQueryGroup(hitPolicy, group, out);
+    return true;
+}
+
+// Approximate memory held by a SAMAlignment.
+size_t SAMAlignmentBytes(const SAMAlignment &samAlignment)
+{
+    return sizeof(SAMAlignment) + samAlignment.qName.size() + samAlignment.rName.size() +
+           samAlignment.cigar.size() + samAlignment.seq.size() + samAlignment.qual.size();
+}
+
+// Sort the alignments in buffer by query and write them, preceded by
+// headers, to a new chunk file.
+void WriteSortedChunk(std::vector<SAMAlignment> &buffer, const std::vector<std::string> &headers,
+                      const std::string &chunkFileName)
+{
+    std::sort(buffer.begin(), buffer.end(), byQNameScoreTStart);
+    std::ofstream chunkOut;
+    CrucialOpen(chunkFileName, chunkOut, std::ios::out);
+    for (size_t i = 0; i < headers.size(); i++) {
+        chunkOut << headers[i] << std::endl;
+    }
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i].PrintSAMAlignment(chunkOut);
+    }
+    chunkOut.close();
+    buffer.clear();
+}
+
+// Filter the alignments of samFileName when they are not grouped by
+// query.  Alignments that pass the filters are sorted by query in
+// chunks of about bufferBytes, which are written to files named
+// chunkPrefix.0, chunkPrefix.1, ..., and merged.  The hit policy is
+// applied to each query of the merge.
+template <typename T_Filter>
+void FilterUngroupedAlignments(const std::string &samFileName, T_Filter &filterAlignment,
+                               FilterCriteria &filterCriteria, HitPolicy &hitPolicy,
+                               const std::vector<std::string> &headers,
+                               const std::string &chunkPrefix, size_t bufferBytes, int numThreads,
+                               std::ostream &out)
+{
+    typedef SAMReader<SAMFullReferenceSequence, SAMReadGroup, SAMAlignment> Reader;
+    Reader samReader;
+    samReader.Initialize(samFileName);
+    AlignmentSet<SAMFullReferenceSequence, SAMReadGroup, SAMAlignment> alignmentSet;
+    samReader.ReadHeader(alignmentSet);
+    FilteredSAMReader<T_Filter> filteredReader(samReader, filterAlignment, filterCriteria,
+                                               numThreads);
+
+    std::vector<std::string> chunkFileNames;
+    std::vector<SAMAlignment> buffer;
+    size_t bufferedBytes = 0;
+    SAMAlignment samAlignment;
+    while (filteredReader.GetNextAlignment(samAlignment)) {
+        buffer.push_back(samAlignment);
+        bufferedBytes += SAMAlignmentBytes(samAlignment);
+        if (bufferedBytes >= bufferBytes) {
+            std::stringstream chunkFileName;
+            chunkFileName << chunkPrefix << "." << chunkFileNames.size();
+            chunkFileNames.push_back(chunkFileName.str());
+            WriteSortedChunk(buffer, headers, chunkFileNames.back());
+            bufferedBytes = 0;
+        }
+    }
+
+    std::vector<SAMAlignment> group;
+    if (chunkFileNames.empty()) {
+        // Everything fit in the buffer.
+        std::sort(buffer.begin(), buffer.end(), byQNameScoreTStart);
+        for (size_t i = 0; i < buffer.size(); i++) {
+            if (group.size() > 0 and buffer[i].qName != group[0].qName) {
+                WriteQueryGroup(hitPolicy, group, out);
+            }
+            group.push_back(buffer[i]);
+        }
+        WriteQueryGroup(hitPolicy, group, out);
+        return;
+    }
+    if (buffer.size() > 0) {
+        std::stringstream chunkFileName;
+        chunkFileName << chunkPrefix << "." << chunkFileNames.size();
+        chunkFileNames.push_back(chunkFileName.str());
+        WriteSortedChunk(buffer, headers, chunkFileNames.back());
+    }
+
+    //
+    // Merge the chunks, always taking the alignment with the smallest
+    // query name among the next alignments of all chunks, so that the
+    // alignments of a query come out together.
+    //
+    std::vector<Reader *> chunkReaders(chunkFileNames.size());
+    std::vector<SAMAlignment> heads(chunkFileNames.size());
+    auto laterQName = [&heads](size_t a, size_t b) { return heads[b].qName < heads[a].qName; };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(laterQName)> next(laterQName);
+    for (size_t c = 0; c < chunkFileNames.size(); c++) {
+        chunkReaders[c] = new Reader;
+        chunkReaders[c]->Initialize(chunkFileNames[c]);
+        AlignmentSet<SAMFullReferenceSequence, SAMReadGroup, SAMAlignment> chunkSet;
+        chunkReaders[c]->ReadHeader(chunkSet);
+        if (chunkReaders[c]->GetNextAlignment(heads[c])) {
+            next.push(c);
+        }
+    }
+    while (not next.empty()) {
+        size_t c = next.top();
+        next.pop();
+        if (group.size() > 0 and heads[c].qName != group[0].qName) {
+            WriteQueryGroup(hitPolicy, group, out);
+        }
+        // Scores are not stored in the chunks, only the AS tag.
+        heads[c].score = heads[c].as;
+        group.push_back(heads[c]);
+        if (chunkReaders[c]->GetNextAlignment(heads[c])) {
+            next.push(c);
+        }
+    }
+    WriteQueryGroup(hitPolicy, group, out);
+
+    for (size_t c = 0; c < chunkFileNames.size(); c++) {
+        delete chunkReaders[c];
+        std::remove(chunkFileNames[c].c_str());
+    }
+}
+
 // Convert references[...].title in reference.fasta to their corresponding
 // indices in the title table.
 void ConvertTitlesToTitleTableIndices(std::vector<FASTASequence> &references,
@@ -175,16 +525,107 @@ void ConvertTitlesToTitleTableIndices(std::vector<FASTASequence> &references,
     tt.Free();
 }
 
-// Return true if the alignment can only map to an adapter specified
-// in the adapter GFF file.
+// The adapters of an adapter GFF file, indexed per reference so that
+// checking an alignment only looks at the adapters it overlaps.
 // A sample record in adapter GFF file:
 // ref000001   .   adapter 10955   10999   0.00    +   .   xxxx
 // ref000001   .   adapter 32886   32930   0.00    +   .   xxxx
 // Note that the first field (e.g., 'ref000001') is id of sequence
-// in a reference repository, not sequence name, so we need to
-// reconstruct the mapping between sequence id and sequence name.
-bool CheckAdapterOnly(GFFFile &adapterGffFile,          //Adapter gff file
-                      AlignmentCandidate<> &alignment,  // An alignment
+// in a reference repository, not sequence name, so a record belongs to
+// the reference with that name or with that id.
+class AdapterIndex
+{
+public:
+    void Initialize(GFFFile &adapterGffFile, std::vector<FASTASequence> &references,
+                    std::map<std::string, int> &refNameToIndex);
+
+    // Return true if alignment, on reference refIndex, can only map to
+    // an adapter.
+    bool IsAdapterOnly(AlignmentCandidate<> &alignment, int refIndex) const;
+
+private:
+    // Adapters of each reference in forward strand coordinates, from
+    // the 0-based start to the 0-based exclusive end of the GFF record.
+    std::vector<std::vector<long> > starts, ends;
+    std::vector<IntervalIndex> indices;
+
+    void Add(int refIndex, GFFEntry &entry, DNALength refLength);
+};
+
+inline void AdapterIndex::Initialize(GFFFile &adapterGffFile,
+                                     std::vector<FASTASequence> &references,
+                                     std::map<std::string, int> &refNameToIndex)
+{
+    starts.assign(references.size(), std::vector<long>());
+    ends.assign(references.size(), std::vector<long>());
+    for (size_t eindex = 0; eindex < adapterGffFile.entries.size(); eindex++) {
+        GFFEntry &entry = adapterGffFile.entries[eindex];
+        if (entry.type != "adapter") {
+            continue;
+        }
+        std::map<std::string, int>::iterator byName = refNameToIndex.find(entry.name);
+        if (byName != refNameToIndex.end()) {
+            Add(byName->second, entry, references[byName->second].length);
+        }
+        // Reconstruct the index from an id in the format "ref00000?".
+        int refId;
+        char rest;
+        if (sscanf(entry.name.c_str(), "ref%d%c", &refId, &rest) == 1 and refId >= 1 and
+            size_t(refId) <= references.size()) {
+            char buf[16];
+            sprintf(buf, "ref%06d", refId);
+            if (entry.name == buf and
+                (byName == refNameToIndex.end() or byName->second != refId - 1)) {
+                Add(refId - 1, entry, references[refId - 1].length);
+            }
+        }
+    }
+    indices.resize(references.size());
+    for (size_t r = 0; r < references.size(); r++) {
+        indices[r].Initialize(starts[r], ends[r]);
+        for (size_t a = 0; a < starts[r].size(); a++) {
+            indices[r].Activate(a);
+        }
+    }
+}
+
+inline void AdapterIndex::Add(int refIndex, GFFEntry &entry, DNALength refLength)
+{
+    // Convert each GFF record from 1-based inclusive to
+    // 0-based exclusive.
+    long estart = long(entry.start) - 1;
+    long eend = entry.end;
+    if (entry.strand == '-') {
+        long tmp = estart;
+        estart = long(refLength) - 1 - eend;
+        eend = long(refLength) - 1 - tmp;
+    }
+    starts[refIndex].push_back(estart);
+    ends[refIndex].push_back(eend);
+}
+
+inline bool AdapterIndex::IsAdapterOnly(AlignmentCandidate<> &alignment, int refIndex) const
+{
+    static const long FUZZY_OVERLAP = 20;
+    long tBegin = alignment.GenomicTBegin();
+    long tEnd = alignment.GenomicTEnd();
+    std::vector<int> overlapping;
+    indices[refIndex].FindIntersecting(tBegin, tEnd, overlapping);
+    for (size_t o = 0; o < overlapping.size(); o++) {
+        long estart = starts[refIndex][overlapping[o]];
+        long eend = ends[refIndex][overlapping[o]];
+        long lengthUnion = std::max(eend, tEnd) - std::min(estart, tBegin);
+        if (lengthUnion < eend - estart + FUZZY_OVERLAP) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Return true if the alignment can only map to an adapter specified
+// in the adapter GFF file.
+bool CheckAdapterOnly(const AdapterIndex &adapterIndex,  // Adapters of the GFF file
+                      AlignmentCandidate<> &alignment,   // An alignment
                       std::map<std::string, int> &refNameToIndex)
 {
     // Map target sequence name to its index in reference repository.
@@ -194,35 +635,7 @@ bool CheckAdapterOnly(GFFFile &adapterGffFile,          //Adapter gff file
                   << " in the reference file." << std::endl;
         std::exit(EXIT_FAILURE);
     }
-    int refNameIndex = refNameToIndex[alignment.tName];
-    char buf[16];
-    sprintf(buf, "ref%06d", refNameIndex + 1);
-    // Reconstruct ref id in the format "ref00000?".
-    std::string refNameId(buf);
-    int FUZZY_OVERLAP = 20;
-    for (size_t eindex = 0; eindex < adapterGffFile.entries.size(); eindex++) {
-        GFFEntry &entry = adapterGffFile.entries[eindex];
-        // Convert each GFF record from 1-based inclusive to
-        // 0-based exclusive.
-        if (entry.type == "adapter" and
-            (entry.name == alignment.tName or entry.name == refNameId)) {
-            UInt estart = entry.start - 1;
-            UInt eend = entry.end;
-            if (entry.strand == '-') {
-                UInt tmp = estart;
-                estart = alignment.tLength - 1 - eend;
-                eend = alignment.tLength - 1 - tmp;
-            }
-            if (not(eend < alignment.GenomicTBegin() or estart > alignment.GenomicTEnd())) {
-                UInt lengthUnion = std::max(eend, alignment.GenomicTEnd()) -
-                                   std::min(estart, alignment.GenomicTBegin());
-                if (lengthUnion < eend - estart + FUZZY_OVERLAP) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+    return adapterIndex.IsAdapterOnly(alignment, refNameToIndex.find(alignment.tName)->second);
 }
 
 int main(int argc, char *argv[])
@@ -240,7 +653,7 @@ int main(int argc, char *argv[])
     std::string samFileName, refFileName, outFileName;
 
     CommandLineParser clp;
-    clp.RegisterStringOption("file.sam", &samFileName, "Input SAM file.");
+    clp.RegisterStringOption("file.sam", &samFileName, "Input SAM or BAM file.");
     clp.RegisterStringOption("reference.fasta", &refFileName, "Reference used to generate reads.");
     clp.RegisterStringOption("out.sam", &outFileName, "Output SAM file.");
     clp.RegisterPreviousFlagsAsHidden();
@@ -296,6 +709,27 @@ int main(int argc, char *argv[])
                              "Use this option to remove reads which can only map to adapters "
                              "specified in the GFF file.");
 
+    bool streamInput = false;
+    clp.RegisterFlagOption("stream", &streamInput,
+                           "Filter the alignments of one query at a time instead of reading "
+                           "all of them into memory.  Alignments are written in the order "
+                           "their queries appear in the input rather than sorted by reference. "
+                           "This expects the alignments of a query to be adjacent, as blasr "
+                           "writes them; otherwise the input is sorted by query on disk next to "
+                           "out.sam, which needs file.sam and out.sam to be regular files.");
+
+    int sortBufferMB = 1024;
+    clp.RegisterIntOption("sortBufferMB", &sortBufferMB,
+                          "(1024) Memory used by -stream to sort input that is not grouped "
+                          "by query.",
+                          CommandLineParser::PositiveInteger);
+
+    int numThreads = 1;
+    clp.RegisterIntOption("nproc", &numThreads,
+                          "(1) Number of threads that evaluate the filters. Output is the same "
+                          "as with one thread.",
+                          CommandLineParser::PositiveInteger);
+
     bool verbose = false;
     clp.RegisterFlagOption("v", &verbose, "Be verbose.");
 
@@ -353,9 +787,27 @@ int main(int argc, char *argv[])
     FASTAReader fastaReader;
 
     //
-    // Initialize samReader and fastaReader.
+    // Initialize samReader and fastaReader.  BAM records are decoded
+    // to SAM on a separate thread as they are read.
     //
-    samReader.Initialize(samFileName);
+    bool isBam =
+        (samFileName.size() > 4 and samFileName.compare(samFileName.size() - 4, 4, ".bam") == 0);
+    std::string samInputName = samFileName;
+#ifdef USE_PBBAM
+    BamToSamStream bamToSam;
+    if (isBam) {
+        if (bamToSam.Initialize(samFileName) == 0) {
+            std::exit(EXIT_FAILURE);
+        }
+        samInputName = bamToSam.SamFileName();
+    }
+#else
+    if (isBam) {
+        std::cout << "ERROR, BAM input requires samFilter to be built with pbbam." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+#endif
+    samReader.Initialize(samInputName);
     fastaReader.Initialize(refFileName);
 
     //
@@ -412,43 +864,48 @@ int main(int argc, char *argv[])
         refNameToIndex[refName] = i;
     }
 
-    //
-    // Store the alignments.
-    //
-    SAMAlignment samAlignment;
-    size_t alignIndex = 0;
+    AdapterIndex adapterIndex;
+    if (adapterGffFileName != "") {
+        adapterIndex.Initialize(adapterGffFile, references, refNameToIndex);
+    }
 
     //
-    // For 150K, each chip produces about 300M sequences
-    // (not including quality values and etc.).
-    // Let's assume that the sam file and reference data can
-    // fit in the memory.
-    // Need to scale for larger sequal data in the future.
+    // Filter samAlignment into result, setting its score.  This runs
+    // on -nproc threads at once, so it must only read the references
+    // and the adapters, and must leave printing to the reader.  Each
+    // thread converts against its own copy of refNameToIndex, which
+    // the conversion takes by non-const reference.
     //
-    std::vector<SAMAlignment> allSAMAlignments;
-    while (samReader.GetNextAlignment(samAlignment)) {
+    auto filterAlignment = [&, refNameToIndex](SAMAlignment &samAlignment,
+                                               SAMFilterResult &result) mutable {
+        result.Reset();
         if (samAlignment.rName == "*") {
-            continue;
+            return;
         }
 
+        std::stringstream messages;
         if (parseSmrtTitle and holeNumberStr.size() != 0) {
             std::string movieName;
             int thisHoleNumber;
             if (not ParsePBIReadName(samAlignment.qName, movieName, thisHoleNumber)) {
-                std::cout << "ERROR, could not parse SMRT title: " << samAlignment.qName << "."
-                          << std::endl;
-                std::exit(EXIT_FAILURE);
+                messages << "ERROR, could not parse SMRT title: " << samAlignment.qName << "."
+                         << std::endl;
+                result.messages = messages.str();
+                result.isFatal = true;
+                return;
             }
             if (not holeNumberRanges.contains(UInt(thisHoleNumber))) {
-                if (verbose) std::cout << thisHoleNumber << " is not in range." << std::endl;
-                continue;
+                if (verbose) messages << thisHoleNumber << " is not in range." << std::endl;
+                result.messages = messages.str();
+                return;
             }
         }
 
         if (samAlignment.cigar.find('P') != std::string::npos) {
-            std::cout << "WARNING. Could not process SAM record with 'P' in "
-                      << "its cigar string." << std::endl;
-            continue;
+            messages << "WARNING. Could not process SAM record with 'P' in "
+                     << "its cigar string." << std::endl;
+            result.messages = messages.str();
+            return;
         }
 
         std::vector<AlignmentCandidate<> > convertedAlignments;
@@ -456,63 +913,118 @@ int main(int argc, char *argv[])
                                   parseSmrtTitle, false);
 
         if (convertedAlignments.size() > 1) {
-            std::cout << "WARNING. Ignore multiple segments." << std::endl;
-            continue;
+            messages << "WARNING. Ignore multiple segments." << std::endl;
+            result.messages = messages.str();
+            return;
         }
 
-        for (int i = 0; i < 1; i++) {
-            AlignmentCandidate<> &alignment = convertedAlignments[i];
+        AlignmentCandidate<> &alignment = convertedAlignments[0];
 
-            //score func does not matter
-            DistanceMatrixScoreFunction<DNASequence, DNASequence> distFunc;
-            ComputeAlignmentStats(alignment, alignment.qAlignedSeq.seq, alignment.tAlignedSeq.seq,
-                                  distFunc);
+        //score func does not matter
+        DistanceMatrixScoreFunction<DNASequence, DNASequence> distFunc;
+        ComputeAlignmentStats(alignment, alignment.qAlignedSeq.seq, alignment.tAlignedSeq.seq,
+                              distFunc);
 
-            // Check whether this alignment can only map to adapters in
-            // the adapter GFF file.
-            if (adapterGffFileName != "" and
-                CheckAdapterOnly(adapterGffFile, alignment, refNameToIndex)) {
-                if (verbose) std::cout << alignment.qName << " filter adapter only." << std::endl;
-                continue;
-            }
+        // Assign score to samAlignment.
+        samAlignment.score = samAlignment.as;
 
-            // Assign score to samAlignment.
-            samAlignment.score = samAlignment.as;
+        // Check whether this alignment can only map to adapters in
+        // the adapter GFF file.
+        if (adapterGffFileName != "" and
+            CheckAdapterOnly(adapterIndex, alignment, refNameToIndex)) {
+            if (verbose) messages << alignment.qName << " filter adapter only." << std::endl;
+            result.messages = messages.str();
+        } else {
+            // The reader checks the criteria on the statistics.
+            result.checkCriteria = true;
+        }
+        alignment.FreeSubsequences();
+        if (result.checkCriteria) {
+            result.alignment = alignment;
+        }
+    };
 
-            if (not filterCriteria.Satisfy(static_cast<AlignmentCandidate<> *>(&alignment))) {
-                continue;
+    FilteredSAMReader<decltype(filterAlignment)> filteredReader(samReader, filterAlignment,
+                                                                filterCriteria, numThreads);
+    if (streamInput) {
+        if (not FilterGroupedAlignments(filteredReader, hitPolicy, outFileStrm)) {
+            //
+            // What was written so far may miss alignments of queries
+            // that come back later, so start over from a sorted copy.
+            //
+            struct stat samStat, outStat;
+            if (stat(samFileName.c_str(), &samStat) != 0 or not S_ISREG(samStat.st_mode) or
+                stat(outFileName.c_str(), &outStat) != 0 or not S_ISREG(outStat.st_mode)) {
+                std::cout << "ERROR, " << samFileName << " is not grouped by query, and "
+                          << "-stream can only sort regular files. Run without -stream."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
             }
+            if (verbose) {
+                std::cout << samFileName << " is not grouped by query, sorting it." << std::endl;
+            }
+            outFileStrm.close();
+            CrucialOpen(outFileName, outFileStrm, std::ios::out);
+            for (size_t i = 0; i < allHeaders.size(); i++) {
+                outFileStrm << allHeaders[i] << std::endl;
+            }
+#ifdef USE_PBBAM
+            // Stop decoding the first pass, and decode the BAM file again.
+            if (isBam) {
+                if (bamToSam.Close() == 0 or bamToSam.Initialize(samFileName) == 0) {
+                    std::exit(EXIT_FAILURE);
+                }
+                samInputName = bamToSam.SamFileName();
+            }
+#endif
+            FilterUngroupedAlignments(samInputName, filterAlignment, filterCriteria, hitPolicy,
+                                      allHeaders, outFileName + ".sort", size_t(sortBufferMB) << 20,
+                                      numThreads, outFileStrm);
+        }
+    } else {
+        //
+        // For 150K, each chip produces about 300M sequences
+        // (not including quality values and etc.).
+        // Let's assume that the sam file and reference data can
+        // fit in the memory, or use -stream.
+        //
+        SAMAlignment samAlignment;
+        std::vector<SAMAlignment> allSAMAlignments;
+        while (filteredReader.GetNextAlignment(samAlignment)) {
             allSAMAlignments.push_back(samAlignment);
+        }
 
-            alignment.FreeSubsequences();
+        // Sort all SAM alignments by qName, score and target position.
+        sort(allSAMAlignments.begin(), allSAMAlignments.end(), byQNameScoreTStart);
+
+        unsigned int groupBegin = 0;
+        unsigned int groupEnd = -1;
+        std::vector<SAMAlignment> filteredSAMAlignments;
+        while (groupBegin < allSAMAlignments.size()) {
+            // Get the next group of SAM alignments which have the same qName
+            // from allSAMAlignments[groupBegin ... groupEnd)
+            GetNextSAMAlignmentGroup(allSAMAlignments, groupBegin, groupEnd);
+            std::vector<unsigned int> hitIndices =
+                ApplyHitPolicy(hitPolicy, allSAMAlignments, groupBegin, groupEnd);
+            for (unsigned int i = 0; i < hitIndices.size(); i++) {
+                filteredSAMAlignments.push_back(allSAMAlignments[hitIndices[i]]);
+            }
+            groupBegin = groupEnd;
         }
-        ++alignIndex;
-    }
-
-    // Sort all SAM alignments by qName, score and target position.
-    sort(allSAMAlignments.begin(), allSAMAlignments.end(), byQNameScoreTStart);
-
-    unsigned int groupBegin = 0;
-    unsigned int groupEnd = -1;
-    std::vector<SAMAlignment> filteredSAMAlignments;
-    while (groupBegin < allSAMAlignments.size()) {
-        // Get the next group of SAM alignments which have the same qName
-        // from allSAMAlignments[groupBegin ... groupEnd)
-        GetNextSAMAlignmentGroup(allSAMAlignments, groupBegin, groupEnd);
-        std::vector<unsigned int> hitIndices =
-            ApplyHitPolicy(hitPolicy, allSAMAlignments, groupBegin, groupEnd);
-        for (unsigned int i = 0; i < hitIndices.size(); i++) {
-            filteredSAMAlignments.push_back(allSAMAlignments[hitIndices[i]]);
+
+        // Sort all SAM alignments by reference name and query name
+        sort(filteredSAMAlignments.begin(), filteredSAMAlignments.end(), byRNameQName);
+
+        for (unsigned int i = 0; i < filteredSAMAlignments.size(); i++) {
+            filteredSAMAlignments[i].PrintSAMAlignment(outFileStrm);
         }
-        groupBegin = groupEnd;
     }
 
-    // Sort all SAM alignments by reference name and query name
-    sort(filteredSAMAlignments.begin(), filteredSAMAlignments.end(), byRNameQName);
-
-    for (unsigned int i = 0; i < filteredSAMAlignments.size(); i++) {
-        filteredSAMAlignments[i].PrintSAMAlignment(outFileStrm);
+#ifdef USE_PBBAM
+    if (bamToSam.Close() == 0) {
+        std::exit(EXIT_FAILURE);
     }
+#endif
 
     if (outFileName != "") {
         outFileStrm.close();
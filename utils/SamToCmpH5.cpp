@@ -1,4 +1,5 @@
 #include <iostream>
+#include <vector>
 
 #include <alignment/datastructures/alignment/AlignmentCandidate.hpp>
 #include <alignment/datastructures/alignment/SAMToAlignmentCandidateAdapter.hpp>
@@ -11,6 +12,7 @@
 #include <pbdata/FASTASequence.hpp>
 #include <pbdata/sam/SAMReader.hpp>
 #include <pbdata/utils/TimeUtils.hpp>
+#include "../iblasr/BatchConverter.hpp"
 
 char VERSION[] = "v1.0.0";
 char PERFORCE_VERSION_STRING[] = "$Change: 141782 $";
@@ -27,6 +29,7 @@ int main(int argc, char* argv[])
     CommandLineParser clp;
     std::string readType = "standard";
     int verbosity = 0;
+    int numThreads = 1;
 
     clp.SetProgramName(program);
     clp.SetProgramSummary("Converts in.sam file to out.cmp.h5 file.");
@@ -51,6 +54,10 @@ int main(int argc, char* argv[])
                              "or 'cDNA'");
     clp.RegisterIntOption("verbosity", &verbosity, "Set desired verbosity.",
                           CommandLineParser::PositiveInteger);
+    clp.RegisterIntOption("nproc", &numThreads,
+                          "(1) Number of threads that convert SAM records while "
+                          "alignments are written.",
+                          CommandLineParser::PositiveInteger);
     clp.RegisterFlagOption("useShortRefName", &useShortRefName,
                            "Use abbreviated reference names obtained "
                            "from file.sam instead of using full names "
@@ -167,41 +174,81 @@ int main(int argc, char* argv[])
     alignmentSetAdapter.StoreReferenceInfo(alignmentSet.references, cmpFile);
 
     //
-    // Store the alignments.
+    // Store the alignments.  Records are read and alignments are
+    // written on this thread, in input order.  The next batch is read
+    // while the current one is converted, and the current one is
+    // stored while the next one is converted.
     //
-    SAMAlignment samAlignment;
-    while (samReader.GetNextAlignment(samAlignment)) {
-        if (samAlignment.rName == "*") {
-            continue;
-        }
-        if (!useShortRefName) {
-            //convert shortRefName to fullRefName
-            it = shortRefNameToFull.find(samAlignment.rName);
-            if (it == shortRefNameToFull.end()) {
-                std::cout << "ERROR, Could not find " << samAlignment.rName
-                          << " in the reference repository." << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
-            samAlignment.rName = (*it).second;
-        }
-        std::vector<AlignmentCandidate<> > convertedAlignments;
-        if (verbosity > 0) {
-            std::cout << "Storing alignment for " << samAlignment.qName << std::endl;
-        }
+    // The adapter updates its own state as alignments are stored, so
+    // each converter thread reads its own copy of the reference index
+    // map, captured by value.
+    auto refNameToRefInfoIndex = alignmentSetAdapter.refNameToRefInfoIndex;
+    auto convert = [&, refNameToRefInfoIndex](
+        SAMAlignment& samAlignment,
+        std::vector<AlignmentCandidate<> >& convertedAlignments) mutable {
         SAMAlignmentsToCandidates(samAlignment,
                                   // Order of references and alignmentSetAdapter.RefInfoGroup
                                   // should be exactly the same.
-                                  references, alignmentSetAdapter.refNameToRefInfoIndex,
-                                  convertedAlignments, parseSmrtTitle, false, copyQVs);
-
-        // -1: moleculeID will be computed dynamically.
-        // o.w., the value will be assigned as moleculeID.
-        alignmentSetAdapter.StoreAlignmentCandidateList(convertedAlignments, cmpFile, -1, copyQVs);
+                                  references, refNameToRefInfoIndex, convertedAlignments,
+                                  parseSmrtTitle, false, copyQVs);
+    };
+    BatchConverter<SAMAlignment, std::vector<AlignmentCandidate<> >, decltype(convert)> converter(
+        convert, numThreads);
+
+    const size_t batchSize = 1024 * numThreads;
+    auto readBatch = [&](std::vector<SAMAlignment>& batch) {
+        batch.resize(batchSize);
+        size_t numRead = 0;
+        while (numRead < batchSize and samReader.GetNextAlignment(batch[numRead])) {
+            SAMAlignment& samAlignment = batch[numRead];
+            if (samAlignment.rName == "*") {
+                continue;
+            }
+            if (!useShortRefName) {
+                //convert shortRefName to fullRefName
+                it = shortRefNameToFull.find(samAlignment.rName);
+                if (it == shortRefNameToFull.end()) {
+                    std::cout << "ERROR, Could not find " << samAlignment.rName
+                              << " in the reference repository." << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+                samAlignment.rName = (*it).second;
+            }
+            numRead++;
+        }
+        batch.resize(numRead);
+    };
+
+    std::vector<SAMAlignment> batches[2];
+    std::vector<std::vector<AlignmentCandidate<> > > convertedBatches[2];
+    int current = 0;
+    readBatch(batches[current]);
+    converter.Start(batches[current], convertedBatches[current]);
+    while (batches[current].size() > 0) {
+        int next = 1 - current;
+        readBatch(batches[next]);
+        converter.Wait();
+        if (batches[next].size() > 0) {
+            converter.Start(batches[next], convertedBatches[next]);
+        }
+        std::vector<std::vector<AlignmentCandidate<> > >& converted = convertedBatches[current];
+        for (size_t i = 0; i < converted.size(); i++) {
+            if (verbosity > 0) {
+                std::cout << "Storing alignment for " << batches[current][i].qName << std::endl;
+            }
+            // -1: moleculeID will be computed dynamically.
+            // o.w., the value will be assigned as moleculeID.
+            alignmentSetAdapter.StoreAlignmentCandidateList(converted[i], cmpFile, -1, copyQVs);
 
-        for (size_t a = 0; a < convertedAlignments.size(); a++) {
-            convertedAlignments[a].FreeSubsequences();
+            for (size_t a = 0; a < converted[i].size(); a++) {
+                converted[i][a].FreeSubsequences();
+            }
         }
+        converted.clear();
+        batches[current].clear();
+        current = next;
     }
+    converter.Wait();
 
     std::cerr << "[INFO] " << GetTimestamp() << " [" << program << "] ended." << std::endl;
     return 0;
@@ -17,6 +17,8 @@
  */
 
 #include <iostream>
+#include <sstream>
+#include <vector>
 
 #include <alignment/algorithms/alignment/AlignmentUtils.hpp>
 #include <alignment/algorithms/alignment/DistanceMatrixScoreFunction.hpp>
@@ -28,10 +30,22 @@
 #include <pbdata/FASTAReader.hpp>
 #include <pbdata/FASTASequence.hpp>
 #include <pbdata/sam/SAMReader.hpp>
+#include "../iblasr/BatchConverter.hpp"
+#ifdef USE_PBBAM
+#include "../iblasr/BamToSamStream.hpp"
+#endif
 
 char VERSION[] = "v0.1.0";
 char PERFORCE_VERSION_STRING[] = "$Change: 126414 $";
 
+// The M4 lines of one SAM record, and the warnings converting it.
+class M4Record
+{
+public:
+    std::string m4;
+    std::string warning;
+};
+
 int main(int argc, char* argv[])
 {
     std::string program = "samtom4";
@@ -42,12 +56,14 @@ int main(int argc, char* argv[])
     bool printHeader = false;
     bool parseSmrtTitle = false;
     bool useShortRefName = false;
+    int numThreads = 1;
 
     CommandLineParser clp;
     clp.SetProgramName(program);
     clp.SetVersion(versionString);
-    clp.SetProgramSummary("Converts a SAM file generated by blasr to M4 format.");
-    clp.RegisterStringOption("in.sam", &samFileName, "Input SAM file, which is produced by blasr.");
+    clp.SetProgramSummary("Converts a SAM or BAM file generated by blasr to M4 format.");
+    clp.RegisterStringOption("in.sam", &samFileName,
+                             "Input SAM or BAM file, which is produced by blasr.");
     clp.RegisterStringOption("reference.fasta", &refFileName,
                              "Reference used to generate file.sam.");
     clp.RegisterStringOption("out.m4", &outFileName, "Output in blasr M4 format.");
@@ -57,6 +73,10 @@ int main(int argc, char* argv[])
                            "Use abbreviated reference names obtained "
                            "from file.sam instead of using full names "
                            "from reference.fasta.");
+    clp.RegisterIntOption("nproc", &numThreads,
+                          "(1) Number of threads that convert SAM records. Output is in the "
+                          "order of the input.",
+                          CommandLineParser::PositiveInteger);
     //clp.SetExamples(program + " file.sam reference.fasta out.m4");
 
     clp.ParseCommandLine(argc, argv);
@@ -72,9 +92,27 @@ int main(int argc, char* argv[])
     FASTAReader fastaReader;
 
     //
-    // Initialize samReader and fastaReader.
+    // Initialize samReader and fastaReader.  BAM records are decoded
+    // to SAM on a separate thread as they are read.
     //
-    samReader.Initialize(samFileName);
+    std::string samInputName = samFileName;
+    bool isBam =
+        (samFileName.size() > 4 and samFileName.compare(samFileName.size() - 4, 4, ".bam") == 0);
+#ifdef USE_PBBAM
+    BamToSamStream bamToSam;
+    if (isBam) {
+        if (bamToSam.Initialize(samFileName) == 0) {
+            std::exit(EXIT_FAILURE);
+        }
+        samInputName = bamToSam.SamFileName();
+    }
+#else
+    if (isBam) {
+        std::cout << "ERROR, BAM input requires samtom4 to be built with pbbam." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+#endif
+    samReader.Initialize(samInputName);
     fastaReader.Initialize(refFileName);
 
     //
@@ -128,46 +166,21 @@ int main(int argc, char* argv[])
         refNameToIndex[refName] = i;
     }
 
-    //
-    // Store the alignments.
-    //
-    SAMAlignment samAlignment;
-    size_t alignIndex = 0;
+    if (printHeader) IntervalOutput::PrintHeader(*outFilePtr);
 
     //
-    // For 150K, each chip produces about 300M sequences
-    // (not including quality values and etc.).
-    // Let's assume that the sam file and reference data can
-    // fit in the memory.
-    // Need to scale for larger sequal data in the future.
+    // Convert a record to M4.  This runs on -nproc threads at once,
+    // so it only reads the references, and each thread converts
+    // against its own copy of the name map, captured by value.
     //
-    if (printHeader) IntervalOutput::PrintHeader(*outFilePtr);
-
-    // The socre matrix does not matter because we will use the
-    // aligner's score from SAM file anyway.
-    DistanceMatrixScoreFunction<DNASequence, DNASequence> distScoreFn;
-
-    while (samReader.GetNextAlignment(samAlignment)) {
-        if (samAlignment.rName == "*") {
-            continue;
-        }
-
-        if (!useShortRefName) {
-            //convert shortRefName to fullRefName
-            it = shortRefNameToFull.find(samAlignment.rName);
-            if (it == shortRefNameToFull.end()) {
-                std::cout << "ERROR, Could not find " << samAlignment.rName
-                          << " in the reference repository." << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
-            samAlignment.rName = (*it).second;
-        }
+    auto convert = [&, refNameToIndex](SAMAlignment& samAlignment, M4Record& record) mutable {
+        record.m4.clear();
+        record.warning.clear();
 
         // The padding character 'P' is not supported
         if (samAlignment.cigar.find('P') != std::string::npos) {
-            std::cout << "WARNING. Could not process sam record with 'P' in its cigar string."
-                      << std::endl;
-            continue;
+            record.warning = "WARNING. Could not process sam record with 'P' in its cigar string.";
+            return;
         }
 
         std::vector<AlignmentCandidate<> > convertedAlignments;
@@ -183,36 +196,102 @@ int main(int argc, char* argv[])
                                   parseSmrtTitle, keepRefAsForward);
 
         if (convertedAlignments.size() > 1) {
-            std::cout << "WARNING. Ignore an alignment which has multiple segments." << std::endl;
-            continue;
+            record.warning = "WARNING. Ignore an alignment which has multiple segments.";
+            return;
         }
 
+        // The socre matrix does not matter because we will use the
+        // aligner's score from SAM file anyway.
+        DistanceMatrixScoreFunction<DNASequence, DNASequence> distScoreFn;
+
         //all alignments are unique single-ended alignments.
-        for (int i = 0; i < 1; i++) {
-            AlignmentCandidate<>& alignment = convertedAlignments[i];
+        AlignmentCandidate<>& alignment = convertedAlignments[0];
+
+        ComputeAlignmentStats(alignment, alignment.qAlignedSeq.seq, alignment.tAlignedSeq.seq,
+                              distScoreFn);
+
+        // Use aligner's score from SAM file anyway.
+        alignment.score = samAlignment.as;
+        alignment.mapQV = samAlignment.mapQV;
 
-            ComputeAlignmentStats(alignment, alignment.qAlignedSeq.seq, alignment.tAlignedSeq.seq,
-                                  distScoreFn);
+        // Since SAM only has the aligned sequence, many info of the
+        // original query (e.g. the full length) is missing.
+        // Overwrite alignment.qLength (which is length of the query
+        // in the SAM alignment) with xq (which is the length of the
+        // original query sequence saved by blasr) right before printing
+        // the output so that one can reconstruct a blasr m4 record from
+        // a blasr sam alignment.
+        if (samAlignment.xq != 0) alignment.qLength = samAlignment.xq;
 
-            // Use aligner's score from SAM file anyway.
-            alignment.score = samAlignment.as;
-            alignment.mapQV = samAlignment.mapQV;
+        std::stringstream m4Strm;
+        IntervalOutput::PrintFromSAM(alignment, m4Strm);
+        record.m4 = m4Strm.str();
 
-            // Since SAM only has the aligned sequence, many info of the
-            // original query (e.g. the full length) is missing.
-            // Overwrite alignment.qLength (which is length of the query
-            // in the SAM alignment) with xq (which is the length of the
-            // original query sequence saved by blasr) right before printing
-            // the output so that one can reconstruct a blasr m4 record from
-            // a blasr sam alignment.
-            if (samAlignment.xq != 0) alignment.qLength = samAlignment.xq;
+        alignment.FreeSubsequences();
+    };
+    BatchConverter<SAMAlignment, M4Record, decltype(convert)> converter(convert, numThreads);
 
-            IntervalOutput::PrintFromSAM(alignment, *outFilePtr);
+    //
+    // Read a batch of records with references, mapping their reference
+    // names to full names.
+    //
+    const size_t batchSize = 1024 * numThreads;
+    auto readBatch = [&](std::vector<SAMAlignment>& batch) {
+        batch.resize(batchSize);
+        size_t numRead = 0;
+        while (numRead < batchSize and samReader.GetNextAlignment(batch[numRead])) {
+            SAMAlignment& samAlignment = batch[numRead];
+            if (samAlignment.rName == "*") {
+                continue;
+            }
+            if (!useShortRefName) {
+                //convert shortRefName to fullRefName
+                it = shortRefNameToFull.find(samAlignment.rName);
+                if (it == shortRefNameToFull.end()) {
+                    std::cout << "ERROR, Could not find " << samAlignment.rName
+                              << " in the reference repository." << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+                samAlignment.rName = (*it).second;
+            }
+            numRead++;
+        }
+        batch.resize(numRead);
+    };
 
-            alignment.FreeSubsequences();
+    //
+    // Records are read and written on this thread, in input order.
+    // The next batch is read while the current one is converted.
+    //
+    std::vector<SAMAlignment> batches[2];
+    std::vector<M4Record> convertedBatches[2];
+    int current = 0;
+    readBatch(batches[current]);
+    converter.Start(batches[current], convertedBatches[current]);
+    while (batches[current].size() > 0) {
+        int next = 1 - current;
+        readBatch(batches[next]);
+        converter.Wait();
+        if (batches[next].size() > 0) {
+            converter.Start(batches[next], convertedBatches[next]);
         }
-        ++alignIndex;
+        std::vector<M4Record>& converted = convertedBatches[current];
+        for (size_t i = 0; i < converted.size(); i++) {
+            if (converted[i].warning != "") {
+                std::cout << converted[i].warning << std::endl;
+            }
+            *outFilePtr << converted[i].m4;
+        }
+        converted.clear();
+        batches[current].clear();
+        current = next;
+    }
+    converter.Wait();
+#ifdef USE_PBBAM
+    if (bamToSam.Close() == 0) {
+        std::exit(EXIT_FAILURE);
     }
+#endif
 
     if (outFileName != "") {
         outFileStrm.close();
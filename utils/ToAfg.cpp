@@ -1,5 +1,10 @@
+#include <pthread.h>
+
 #include <algorithm>
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -13,6 +18,99 @@
 #include <pbdata/reads/ReadInterval.hpp>
 #include <pbdata/reads/RegionTable.hpp>
 #include <pbdata/utils.hpp>
+#include "../iblasr/BatchConverter.hpp"
+#include "../iblasr/RegionTableStream.hpp"
+
+// A read with its regions, and the parts of it to write, as found
+// from its regions.
+class AfgRead
+{
+public:
+    CCSSequence seq;
+    RegionTable zmwRegionTable;
+    // Write the whole read instead of subreads.
+    bool writeWholeRead;
+    std::vector<DNALength> subreadStarts;
+    std::vector<DNALength> subreadEnds;
+    std::vector<std::string> subreadTitles;
+};
+
+//
+// Writes a batch of reads with an AfgBasWriter from a thread of its
+// own, so that writing one batch overlaps with reading the next.
+// Batches are written one at a time and in order, so records are
+// numbered as when they are written by a single thread.
+//
+class AfgBatchWriter
+{
+public:
+    explicit AfgBatchWriter(AfgBasWriter& afgWriterP) : afgWriter(afgWriterP), running(false) {}
+
+    ~AfgBatchWriter() { Wait(); }
+
+    // Start writing batch, and free its reads when done.
+    void Start(std::vector<AfgRead>& batchP);
+
+    // Wait until the batch started last is written.
+    void Wait();
+
+private:
+    AfgBasWriter& afgWriter;
+    std::vector<AfgRead>* batch;
+    bool running;
+    pthread_t thread;
+
+    static void* Run(void* writerP);
+
+    void WriteBatch();
+};
+
+inline void AfgBatchWriter::Start(std::vector<AfgRead>& batchP)
+{
+    assert(not running);
+    batch = &batchP;
+    if (pthread_create(&thread, NULL, Run, this) != 0) {
+        std::cout << "ERROR, could not start the afg writer thread." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    running = true;
+}
+
+inline void AfgBatchWriter::Wait()
+{
+    if (running) {
+        pthread_join(thread, NULL);
+        running = false;
+    }
+}
+
+inline void* AfgBatchWriter::Run(void* writerP)
+{
+    static_cast<AfgBatchWriter*>(writerP)->WriteBatch();
+    return NULL;
+}
+
+inline void AfgBatchWriter::WriteBatch()
+{
+    for (size_t r = 0; r < batch->size(); r++) {
+        AfgRead& read = (*batch)[r];
+        if (read.writeWholeRead) {
+            afgWriter.Write(read.seq);
+        }
+        for (size_t intvIndex = 0; intvIndex < read.subreadStarts.size(); intvIndex++) {
+            SMRTSequence subreadSequence;
+            DNALength subreadStart = read.subreadStarts[intvIndex];
+            DNALength subreadEnd = read.subreadEnds[intvIndex];
+
+            subreadSequence.SubreadStart(subreadStart);
+            subreadSequence.SubreadEnd(subreadEnd);
+            subreadSequence.ReferenceSubstring(read.seq, subreadStart, subreadEnd - subreadStart);
+            subreadSequence.CopyTitle(read.subreadTitles[intvIndex]);
+            afgWriter.Write(subreadSequence);
+        }
+        read.seq.Free();
+    }
+}
 
 void PrintUsage()
 {
@@ -23,6 +121,7 @@ void PrintUsage()
               << "                                         [-noSplitSubreads]" << std::endl
               << "                                         [-useccsdenovo]" << std::endl
               << "                                         [-uniformQV QV]" << std::endl
+              << "                                         [-nproc n]" << std::endl
               << "Print reads stored in a file (pls|fasta|fastq) as an afg." << std::endl;
 }
 
@@ -39,7 +138,6 @@ int main(int argc, char* argv[])
     inputFileName = argv[1];
     outputFileName = argv[2];
     int argi = 3;
-    RegionTable regionTable;
     std::string regionsFOFNName = "";
     std::vector<std::string> regionFileNames;
     bool splitSubreads = true;
@@ -47,6 +145,7 @@ int main(int argc, char* argv[])
     bool useUniformQV = false;
     int uniformQV = 7;
     int minSubreadLength = 1;
+    int numThreads = 1;
     while (argi < argc) {
         if (strcmp(argv[argi], "-regionTable") == 0) {
             regionsFOFNName = argv[++argi];
@@ -59,6 +158,13 @@ int main(int argc, char* argv[])
         } else if (strcmp(argv[argi], "-uniformQV") == 0) {
             useUniformQV = true;
             uniformQV = atoi(argv[++argi]);
+        } else if (strcmp(argv[argi], "-nproc") == 0) {
+            numThreads = atoi(argv[++argi]);
+            if (numThreads <= 0) {
+                std::cout << "ERROR, " << argv[argi] << " is not a valid number of threads."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
         } else {
             PrintUsage();
             std::cout << "ERROR! Option " << argv[argi] << " is not supported." << std::endl;
@@ -83,7 +189,6 @@ int main(int argc, char* argv[])
 
     std::ofstream fastaOut;
     CrucialOpen(outputFileName, fastaOut);
-    HDFRegionTableReader hdfRegionReader;
     AfgBasWriter afgWriter;
     if (useUniformQV) {
         afgWriter.SetDefaultQuality(uniformQV);
@@ -91,12 +196,85 @@ int main(int argc, char* argv[])
 
     afgWriter.Initialize(outputFileName);
 
-    for (size_t plsFileIndex = 0; plsFileIndex < inputFileNames.size(); plsFileIndex++) {
-        if (splitSubreads) {
-            hdfRegionReader.Initialize(regionFileNames[plsFileIndex]);
-            hdfRegionReader.ReadTable(regionTable);
+    AfgBatchWriter batchWriter(afgWriter);
+
+    //
+    // Find the parts of a read to write.  This runs on -nproc threads
+    // at once, so warnings are returned to be printed in input order.
+    //
+    auto splitRead = [&](AfgRead& read, std::string& warning) {
+        CCSSequence& seq = read.seq;
+        read.writeWholeRead = false;
+        read.subreadStarts.clear();
+        read.subreadEnds.clear();
+        read.subreadTitles.clear();
+        warning.clear();
+
+        if (useUniformQV && seq.qual.data != NULL) {
+            for (DNALength qvIndex = 0; qvIndex < seq.length; qvIndex++) {
+                seq.qual[qvIndex] = uniformQV;
+            }
+        }
+
+        if (splitSubreads == false) {
+            read.writeWholeRead = (seq.length >= static_cast<DNALength>(minSubreadLength));
+            return;
+        }
+
+        RegionTable& zmwRegionTable = read.zmwRegionTable;
+        DNALength hqReadStart, hqReadEnd;
+        int score;
+        GetReadTrimCoordinates(seq, seq.zmwData, zmwRegionTable, hqReadStart, hqReadEnd, score);
+
+        std::vector<ReadInterval> subreadIntervals;
+        if (zmwRegionTable.HasHoleNumber(seq.HoleNumber())) {
+            subreadIntervals =
+                zmwRegionTable[seq.HoleNumber()].SubreadIntervals(seq.length, true, true);
+        }
+
+        if (seq.length == 0 and subreadIntervals.size() > 0) {
+            std::stringstream warningStream;
+            warningStream
+                << "WARNING! A high quality interval region exists for a read of length 0."
+                << std::endl;
+            warningStream << "  The offending ZMW number is " << seq.HoleNumber() << std::endl;
+            warning = warningStream.str();
+            return;
         }
 
+        for (size_t intvIndex = 0; intvIndex < subreadIntervals.size(); intvIndex++) {
+            DNALength subreadStart =
+                static_cast<DNALength>(subreadIntervals[intvIndex].start) > hqReadStart
+                    ? static_cast<DNALength>(subreadIntervals[intvIndex].start)
+                    : hqReadStart;
+            DNALength subreadEnd =
+                static_cast<DNALength>(subreadIntervals[intvIndex].end) < hqReadEnd
+                    ? static_cast<DNALength>(subreadIntervals[intvIndex].end)
+                    : hqReadEnd;
+            DNALength subreadLength = subreadEnd - subreadStart;
+
+            if (subreadLength < DNALength(minSubreadLength)) continue;
+
+            std::stringstream titleStream;
+            titleStream << seq.title << "/" << subreadIntervals[intvIndex].start << "_"
+                        << subreadIntervals[intvIndex].end;
+            read.subreadStarts.push_back(subreadStart);
+            read.subreadEnds.push_back(subreadEnd);
+            read.subreadTitles.push_back(titleStream.str());
+        }
+    };
+    BatchConverter<AfgRead, std::string, decltype(splitRead)> splitter(splitRead, numThreads);
+
+    for (size_t plsFileIndex = 0; plsFileIndex < inputFileNames.size(); plsFileIndex++) {
+        //
+        // Regions are read along with the reads rather than loading
+        // the whole table of the file first.  Files without a region
+        // table have no subreads, as before.
+        //
+        RegionTableStream regionTableStream;
+        bool hasRegions =
+            splitSubreads and regionTableStream.Initialize(regionFileNames[plsFileIndex]) != 0;
+
         ReaderAgglomerate reader;
         // reader.SkipReadQuality(); // should have been taken care of by *Filter modules
         if (useCCS) {
@@ -105,74 +283,53 @@ int main(int argc, char* argv[])
             reader.IgnoreCCS();
         }
         reader.Initialize(inputFileNames[plsFileIndex]);
-        CCSSequence seq;
-        int seqIndex = 0;
-        std::vector<ReadInterval> subreadIntervals;
-        while (reader.GetNext(seq)) {
-            ++seqIndex;
 
-            if (useUniformQV && seq.qual.data != NULL) {
-                for (DNALength qvIndex = 0; qvIndex < seq.length; qvIndex++) {
-                    seq.qual[qvIndex] = uniformQV;
+        //
+        // Read a batch of reads with their regions.  HDF files are only
+        // read on this thread.
+        //
+        const size_t batchSize = 1024 * numThreads;
+        auto readBatch = [&](std::vector<AfgRead>& batch) {
+            batch.resize(batchSize);
+            size_t numRead = 0;
+            while (numRead < batchSize and reader.GetNext(batch[numRead].seq)) {
+                AfgRead& read = batch[numRead];
+                read.zmwRegionTable.Reset();
+                if (splitSubreads and hasRegions) {
+                    regionTableStream.GetZmwRegions(read.seq.HoleNumber(), read.zmwRegionTable);
                 }
+                numRead++;
             }
+            batch.resize(numRead);
+        };
 
-            if (splitSubreads == false) {
-                if (seq.length >= static_cast<DNALength>(minSubreadLength)) {
-                    afgWriter.Write(seq);
-                }
-                seq.Free();
-                continue;
-            }
-
-            DNALength hqReadStart, hqReadEnd;
-            int score;
-            GetReadTrimCoordinates(seq, seq.zmwData, regionTable, hqReadStart, hqReadEnd, score);
-
-            if (regionTable.HasHoleNumber(seq.HoleNumber())) {
-                subreadIntervals =
-                    regionTable[seq.HoleNumber()].SubreadIntervals(seq.length, true, true);
-            } else {
-                subreadIntervals = {};
+        //
+        // Read the next batch on this thread while the batch before it
+        // is trimmed and split on -nproc threads, and the one before
+        // that is written by the writer thread.  Three batches are in
+        // flight, and each is handed on in input order.
+        //
+        std::vector<AfgRead> batches[3];
+        std::vector<std::string> warnings[3];
+        int current = 0;
+        readBatch(batches[current]);
+        splitter.Start(batches[current], warnings[current]);
+        while (batches[current].size() > 0) {
+            int next = (current + 1) % 3;
+            readBatch(batches[next]);
+            splitter.Wait();
+            batchWriter.Wait();
+            if (batches[next].size() > 0) {
+                splitter.Start(batches[next], warnings[next]);
             }
-
-            if (seq.length == 0 and subreadIntervals.size() > 0) {
-                std::cout
-                    << "WARNING! A high quality interval region exists for a read of length 0."
-                    << std::endl;
-                std::cout << "  The offending ZMW number is " << seq.HoleNumber() << std::endl;
-                seq.Free();
-                continue;
-            }
-
-            for (size_t intvIndex = 0; intvIndex < subreadIntervals.size(); intvIndex++) {
-                SMRTSequence subreadSequence;
-
-                DNALength subreadStart =
-                    static_cast<DNALength>(subreadIntervals[intvIndex].start) > hqReadStart
-                        ? static_cast<DNALength>(subreadIntervals[intvIndex].start)
-                        : hqReadStart;
-                DNALength subreadEnd =
-                    static_cast<DNALength>(subreadIntervals[intvIndex].end) < hqReadEnd
-                        ? static_cast<DNALength>(subreadIntervals[intvIndex].end)
-                        : hqReadEnd;
-                DNALength subreadLength = subreadEnd - subreadStart;
-
-                if (subreadLength < DNALength(minSubreadLength)) continue;
-
-                subreadSequence.SubreadStart(subreadStart);
-                subreadSequence.SubreadEnd(subreadEnd);
-                subreadSequence.ReferenceSubstring(seq, subreadStart, subreadLength);
-
-                std::stringstream titleStream;
-                titleStream << seq.title << "/" << subreadIntervals[intvIndex].start << "_"
-                            << subreadIntervals[intvIndex].end;
-                subreadSequence.CopyTitle(titleStream.str());
-                afgWriter.Write(subreadSequence);
+            for (size_t r = 0; r < warnings[current].size(); r++) {
+                std::cout << warnings[current][r];
             }
-            seq.Free();
+            batchWriter.Start(batches[current]);
+            current = next;
         }
+        batchWriter.Wait();
         reader.Close();
-        hdfRegionReader.Close();
+        regionTableStream.Close();
     }
 }
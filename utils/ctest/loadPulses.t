@@ -78,6 +78,21 @@ Set up the executable: loadPulses.
   \d+ differences found (re)
   [1]
 
+#Test loadPulses -nproc: the metrics are the same as those loaded on one thread.
+  $ CMP_OUT_SORTED_nproc=$OUTDIR/ecoli_lp_tiny_sorted_nproc.cmp.h5
+  $ rm -f $CMP_OUT_SORTED_nproc
+  $ cp $CMP_IN_SORTED $CMP_OUT_SORTED_nproc
+  $ $EXEC $FOFN_IN $CMP_OUT_SORTED_nproc -bymetric -metrics $METRICS -nproc 4 > $OUTDIR/tmp.log
+  [INFO] * [loadPulses] started. (glob)
+  [INFO] * [loadPulses] ended. (glob)
+
+  $ h5diff -c $CMP_OUT_SORTED_nproc $CMP_OUT_SORTED_bymetric
+  dataset: </FileLog/CommandLine> and </FileLog/CommandLine>
+  \d+ differences found (re)
+  dataset: </FileLog/Timestamp> and </FileLog/Timestamp>
+  \d+ differences found (re)
+  [1]
+
 #Test loadPulses for a zero-alignment cmp.h5 file.
   $ FOFN_IN=$DATDIR/ecoli_lp.fofn
   $ CMP_IN_NOALN=$DATDIR/noaln_lp.cmp.h5
@@ -18,3 +18,9 @@ Test pls2fasta output fastq
   $ echo $?
   0
   $ diff $OUTDIR/test_pls2fasta_ecoli.fq $STDDIR/test_pls2fasta_ecoli.fq
+
+Test pls2fasta with -nproc, which must write the same reads in the same order
+  $ $EXEC $DATDIR/ecoli_lp.fofn $OUTDIR/test_pls2fasta_ecoli_nproc.fq -trimByRegion -fastq -nproc 4
+  [INFO] * [pls2fasta] started. (glob)
+  [INFO] * [pls2fasta] ended. (glob)
+  $ diff $OUTDIR/test_pls2fasta_ecoli_nproc.fq $STDDIR/test_pls2fasta_ecoli.fq
@@ -25,6 +25,45 @@ Set up the executable: samFilter.
 #  $ diff $TMP1 $TMP2 
 #  $ rm $TMP1 $TMP2 
 
+#Test samFilter with -stream, which writes the same alignments in input order
+  $ OUTFILE=$OUTDIR/lambda_bax_filter_stream.sam
+  $ STDFILE=$STDDIR/lambda_bax_filter_1.sam
+
+  $ rm -f $OUTFILE
+  $ $EXEC $DATDIR/lambda_bax.sam $DATDIR/lambda_ref.fasta $OUTFILE --minAccuracy 70 --minPctSimilarity 30 --hitPolicy all -stream
+  $ tail -n+7 $OUTFILE |sort > $TMP1
+  $ tail -n+7 $STDFILE |sort > $TMP2
+  $ diff $TMP1 $TMP2
+  $ rm $TMP1 $TMP2
+
+#Test samFilter with -stream on input that is not grouped by query
+  $ UNGROUPED=$OUTDIR/lambda_bax_ungrouped.sam
+  $ (grep '^@' $DATDIR/lambda_bax.sam; grep -v '^@' $DATDIR/lambda_bax.sam | sort -k 4,4n) > $UNGROUPED
+  $ rm -f $OUTFILE
+  $ $EXEC $UNGROUPED $DATDIR/lambda_ref.fasta $OUTFILE --minAccuracy 70 --minPctSimilarity 30 --hitPolicy all -stream -sortBufferMB 1
+  $ tail -n+7 $OUTFILE |sort > $TMP1
+  $ tail -n+7 $STDFILE |sort > $TMP2
+  $ diff $TMP1 $TMP2
+  $ rm $TMP1 $TMP2 $UNGROUPED
+
+#Test samFilter with -stream on a PacBio *.bam file written by blasr, grouped by query and
+#sorted by position, which must keep the same alignments as the same records in a *.sam file
+  $ BAMFILE=$OUTDIR/tiny_bam_filter.bam
+  $ SAMFILE=$OUTDIR/tiny_bam_filter.sam
+  $ rm -f $BAMFILE $SAMFILE $OUTFILE
+  $ ${BLASR_EXE:-$TESTDIR/../../blasr} $DATDIR/test_bam/tiny_bam.fofn $DATDIR/lambda_ref.fasta --bam --out $BAMFILE > /dev/null 2>&1
+  $ ${SAMTOOLS_EXE:-samtools} view -h -o $SAMFILE $BAMFILE
+  $ $EXEC $SAMFILE $DATDIR/lambda_ref.fasta $OUTFILE --hitPolicy all -stream
+  $ grep -v '^@' $OUTFILE |sort > $TMP2
+  $ $EXEC $BAMFILE $DATDIR/lambda_ref.fasta $OUTFILE --hitPolicy all -stream
+  $ grep -v '^@' $OUTFILE |sort > $TMP1
+  $ diff $TMP1 $TMP2
+  $ ${SAMTOOLS_EXE:-samtools} sort -o $BAMFILE.sorted.bam $BAMFILE
+  $ $EXEC $BAMFILE.sorted.bam $DATDIR/lambda_ref.fasta $OUTFILE --hitPolicy all -stream
+  $ grep -v '^@' $OUTFILE |sort > $TMP1
+  $ diff $TMP1 $TMP2
+  $ rm $TMP1 $TMP2 $BAMFILE.sorted.bam
+
 #Test samFilter with -hitPolicy allbest
   $ OUTFILE=$OUTDIR/lambda_bax_filter_2.sam
   $ STDFILE=$STDDIR/lambda_bax_filter_2.sam
@@ -36,6 +75,14 @@ Set up the executable: samFilter.
   $ diff $TMP1 $TMP2 
   $ rm $TMP1 $TMP2 
 
+#Test samFilter with -nproc, which must not change the output
+  $ rm -f $OUTFILE
+  $ $EXEC $DATDIR/lambda_bax.sam $DATDIR/lambda_ref.fasta $OUTFILE --hitPolicy allbest -nproc 4
+  $ tail -n+7 $OUTFILE > $TMP1
+  $ tail -n+7 $STDFILE > $TMP2
+  $ diff $TMP1 $TMP2
+  $ rm $TMP1 $TMP2
+
 #Test samFilter with --hitPolicy random   
   $ OUTFILE=$OUTDIR/lambda_bax_filter_3.sam
   $ STDFILE=$STDDIR/lambda_bax_filter_3.sam
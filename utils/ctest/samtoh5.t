@@ -22,6 +22,18 @@ Set up the executable: samtoh5.
 #  dataset: </FileLog/Version> and </FileLog/Version>
 #  \d+ differences found (re)
 
+#Test samtoh5 with -nproc, which must write the same alignments.
+  $ rm -f $OUTDIR/ecoli_nproc.cmp.h5
+  $ $EXEC -useShortRefName -nproc 4 $DATDIR/ecoli.sam $DATDIR/ecoli_reference.fasta $OUTDIR/ecoli_nproc.cmp.h5
+  [INFO] * [samtoh5] started. (glob)
+  [INFO] * [samtoh5] ended. (glob)
+  $ h5diff $OUTDIR/ecoli_nproc.cmp.h5 $STDDIR/ecoli_2014_10_30.cmp.h5
+  dataset: </FileLog/CommandLine> and </FileLog/CommandLine>
+  \d+ differences found (re)
+  dataset: </FileLog/Timestamp> and </FileLog/Timestamp>
+  \d+ differences found (re)
+  [1]
+
 #Verify bug 21794 has been fixed. 
 #samtoh5 should print the following error message.
   $ rm -f $OUTDIR/bug21794.cmp.h5
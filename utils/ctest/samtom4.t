@@ -42,3 +42,24 @@ Set up the executable: samtom4.
   $ sort -n $OUTFILE > $TMPFILE
   $ diff $TMPFILE $STDFILE
 
+
+#Test samtom4 with -nproc, which must write the same records in the same order.
+  $ TMPFILE=$OUTDIR/test_samtom4_5.tmp
+  $ rm -rf $TMPFILE
+  $ $EXEC $DATDIR/ecoli.sam $DATDIR/ecoli_reference.fasta $TMPFILE -useShortRefName -nproc 4
+  $ diff $TMPFILE $OUTFILE
+
+#Test samtom4 with a PacBio *.bam file written by blasr, which must give the same M4 output
+#as the same records in a *.sam file.  pbbam only reads BAM files whose header has a pb version.
+  $ BAMFILE=$OUTDIR/tiny_bam_samtom4.bam
+  $ SAMFILE=$OUTDIR/tiny_bam_samtom4.sam
+  $ OUTFILE=$OUTDIR/tiny_bam_samtom4.m4
+  $ TMPFILE=$OUTDIR/test_samtom4_6.tmp
+  $ rm -rf $BAMFILE $SAMFILE $OUTFILE $TMPFILE
+  $ ${BLASR_EXE:-$TESTDIR/../../blasr} $DATDIR/test_bam/tiny_bam.fofn $DATDIR/lambda_ref.fasta --bam --out $BAMFILE > /dev/null 2>&1
+  $ ${SAMTOOLS_EXE:-samtools} view -H $BAMFILE | grep -c "^@HD.*pb:"
+  1
+  $ ${SAMTOOLS_EXE:-samtools} view -h -o $SAMFILE $BAMFILE
+  $ $EXEC $SAMFILE $DATDIR/lambda_ref.fasta $OUTFILE
+  $ $EXEC $BAMFILE $DATDIR/lambda_ref.fasta $TMPFILE -nproc 4
+  $ diff $TMPFILE $OUTFILE
@@ -28,3 +28,27 @@ Make OUTDIR
 
   $ md5sum $OUTDIR/ecoli_welter.sa |cut -f 1 -d ' '
   e23b6afe6ddd74b2656e36bf93f6840c
+
+  $ $EXEC $OUTDIR/ecoli_bucket.sa $DATDIR/ecoli_reference.fasta -blt 11 -maxMemoryMB 64
+  $ echo $?
+  0
+
+  $ md5sum $OUTDIR/ecoli_bucket.sa |cut -f 1 -d ' '
+  e23b6afe6ddd74b2656e36bf93f6840c
+
+A budget smaller than the array streams several ranges of buckets, and
+removes the scratch file afterwards.
+  $ $EXEC $OUTDIR/ecoli_ranges.sa $DATDIR/ecoli_reference.fasta -blt 11 -maxMemoryMB 12
+  $ echo $?
+  0
+
+  $ md5sum $OUTDIR/ecoli_ranges.sa |cut -f 1 -d ' '
+  e23b6afe6ddd74b2656e36bf93f6840c
+
+  $ ls $OUTDIR/ecoli_ranges.sa.buckets 2>/dev/null | wc -l
+  0
+
+A memory limit can not be combined with a choice of method.
+  $ $EXEC $OUTDIR/ecoli_both.sa $DATDIR/ecoli_reference.fasta -maxMemoryMB 64 -larsson
+  ERROR, -maxMemoryMB builds the array in buckets, and can not be combined with a choice of method.
+  [1]
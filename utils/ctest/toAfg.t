@@ -68,3 +68,12 @@ test uniform QV FASTA use case
   typ:I
   }
 
+
+test splitting the subreads of a bas.h5 file with more than one batch of reads on
+several threads, which must write the same records in the same order
+  $ BASFILE=$DATDIR/aggressiveIntervalCut/m130812_185809_42141_c100533960310000001823079711101380_s1_p0.bas.h5
+  $ $EXEC $BASFILE $OUTDIR/toAfg_split.afg
+  $ grep -c "^{RED" $OUTDIR/toAfg_split.afg | awk '{print ($1 > 1024)}'
+  1
+  $ $EXEC $BASFILE $OUTDIR/toAfg_split_nproc.afg -nproc 4
+  $ diff $OUTDIR/toAfg_split.afg $OUTDIR/toAfg_split_nproc.afg